@@ -1,10 +1,13 @@
 // DOM Elements
 const weightDisplay = document.getElementById('weight');
 const filamentDisplay = document.getElementById('filament-weight');
+const rateDisplay = document.getElementById('consumption-rate');
 const statusDisplay = document.getElementById('status');
 const tareButton = document.getElementById('tare');
 const calibrateButton = document.getElementById('calibrate');
 const toggleUpdatesButton = document.getElementById('toggle-updates');
+const channelGroup = document.getElementById('channel-group');
+const channelSelect = document.getElementById('channel');
 const vesselsList = document.getElementById('vessels-list');
 const addVesselButton = document.getElementById('add-vessel');
 const vesselModal = document.getElementById('vessel-modal');
@@ -13,6 +16,15 @@ const modalClose = document.getElementById('modal-close');
 const modalTitle = document.getElementById('modal-title');
 const calibrationMarginInput = document.getElementById('calibration-margin');
 const saveMarginButton = document.getElementById('save-margin');
+const calibrationPointsList = document.getElementById('calibration-points');
+const addCalibrationPointButton = document.getElementById('add-calibration-point');
+const clearCalibrationPointsButton = document.getElementById('clear-calibration-points');
+const saveFilterButton = document.getElementById('save-filter');
+const filterInputs = {
+    outlier: { enabled: document.getElementById('filter-outlier-enabled'), value: document.getElementById('filter-outlier-sigma'), key: 'sigma' },
+    median: { enabled: document.getElementById('filter-median-enabled'), value: document.getElementById('filter-median-window'), key: 'window' },
+    ema: { enabled: document.getElementById('filter-ema-enabled'), value: document.getElementById('filter-ema-alpha'), key: 'alpha' }
+};
 
 // Debug check for elements
 console.log('Elements found:', {
@@ -37,14 +49,169 @@ const MAX_RECONNECT_ATTEMPTS = 5;
 const INITIAL_RECONNECT_DELAY = 2000;
 let currentReconnectDelay = INITIAL_RECONNECT_DELAY;
 let updatesEnabled = false;
+// Load cells on this board and the one shown; telemetry and calibration of the others are ignored
+let channelCount = 1;
+let viewedChannel = 0;
 const wsUrl = `ws://${window.location.hostname}/ws`;
 
+// Binary telemetry frame (see src/telemetry.h)
+const TELEMETRY_MAGIC = 0x54;
+const TELEMETRY_VERSION = 3;
+const TELEMETRY_FRAME_SIZE = 35;
+const TELEMETRY_FLAG_STABLE = 0x0001;
+const TELEMETRY_FLAG_VESSEL = 0x0002;
+const TELEMETRY_RATE_UNKNOWN = -0x80000000;
+const TELEMETRY_ETA_UNKNOWN = 0xFFFFFFFF;
+
+function decodeTelemetry(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < TELEMETRY_FRAME_SIZE ||
+        view.getUint8(0) !== TELEMETRY_MAGIC || view.getUint8(1) !== TELEMETRY_VERSION) {
+        console.error('Unknown binary frame');
+        return null;
+    }
+    const flags = view.getUint16(2, true);
+    const data = {
+        seq: view.getUint32(4, true),
+        timestamp: view.getUint32(8, true),
+        raw: view.getInt32(12, true),
+        weight: view.getInt32(16, true) / 1000,
+        stable: (flags & TELEMETRY_FLAG_STABLE) !== 0,
+        channel: view.getUint8(34)
+    };
+    if (flags & TELEMETRY_FLAG_VESSEL) {
+        data.filamentWeight = view.getInt32(20, true) / 1000;
+        data.selectedVessel = view.getInt16(24, true);
+    }
+    const rate = view.getInt32(26, true);
+    if (rate !== TELEMETRY_RATE_UNKNOWN) {
+        data.rate = rate / 1000;
+    }
+    const eta = view.getUint32(30, true);
+    if (eta !== TELEMETRY_ETA_UNKNOWN) {
+        data.eta = eta;
+    }
+    return data;
+}
+
+// Raw sample stream frame: header plus `count` 16-byte samples
+const STREAM_MAGIC = 0x53;
+const STREAM_VERSION = 1;
+const STREAM_HEADER_SIZE = 4;
+const STREAM_SAMPLE_SIZE = 16;
+let lastStreamSeq = null;
+
+function decodeSampleBatch(buffer) {
+    const view = new DataView(buffer);
+    if (view.getUint8(1) !== STREAM_VERSION) {
+        console.error('Unknown sample stream version');
+        return [];
+    }
+    const count = view.getUint16(2, true);
+    const samples = [];
+    for (let i = 0; i < count; i++) {
+        const offset = STREAM_HEADER_SIZE + i * STREAM_SAMPLE_SIZE;
+        if (offset + STREAM_SAMPLE_SIZE > buffer.byteLength) break;
+        samples.push({
+            seq: view.getUint32(offset, true),
+            timestamp: view.getUint32(offset + 4, true),
+            raw: view.getInt32(offset + 8, true),
+            weight: view.getInt32(offset + 12, true) / 1000
+        });
+    }
+    return samples;
+}
+
+function handleSampleBatch(buffer) {
+    const samples = decodeSampleBatch(buffer);
+    for (const sample of samples) {
+        if (lastStreamSeq !== null && sample.seq !== lastStreamSeq + 1) {
+            console.warn(`Sample stream gap: ${sample.seq - lastStreamSeq - 1} samples lost`);
+        }
+        lastStreamSeq = sample.seq;
+        if (capturedSamples) capturedSamples.push(sample);
+    }
+}
+
+// Sample traces for the host replay tool, same format as "capture" on the serial console
+let capturedSamples = null;
+const conversionSettings = { factor: null, offset: null, points: [], filter: null };
+
+function rememberConversionSettings(data) {
+    if (data.calibrationFactor !== undefined) conversionSettings.factor = data.calibrationFactor;
+    if (data.offset !== undefined) conversionSettings.offset = data.offset;
+    if (data.calibrationPoints) conversionSettings.points = data.calibrationPoints;
+    if (data.filter) conversionSettings.filter = data.filter;
+}
+
+function traceHeader() {
+    const lines = ['# filament_scale trace', `# channel=${viewedChannel}`];
+    if (conversionSettings.factor !== null) lines.push(`# factor=${conversionSettings.factor}`);
+    if (conversionSettings.offset !== null) lines.push(`# offset=${conversionSettings.offset}`);
+    conversionSettings.points.forEach(point => lines.push(`# point=${point.counts},${point.weight}`));
+    const filter = conversionSettings.filter;
+    if (filter) {
+        if (filter.outlier.enabled) lines.push(`# outlier=${filter.outlier.sigma}`);
+        if (filter.median.enabled) lines.push(`# median=${filter.median.window}`);
+        if (filter.ema.enabled) lines.push(`# ema=${filter.ema.alpha}`);
+    }
+    lines.push('timestamp_ms,raw');
+    return lines;
+}
+
+// Toggle the raw sample stream from the browser console; it follows the shown load cell
+window.startSampleStream = (batch = 16) => {
+    lastStreamSeq = null;
+    ws.send(JSON.stringify({ command: 'stream', enabled: true, batch, channel: viewedChannel }));
+};
+window.stopSampleStream = () => {
+    ws.send(JSON.stringify({ command: 'stream', enabled: false }));
+};
+
+// Record the stream from the browser console; stopCapture() downloads the trace
+window.startCapture = () => {
+    capturedSamples = [];
+    window.startSampleStream();
+};
+window.stopCapture = (filename = 'trace.csv') => {
+    window.stopSampleStream();
+    if (!capturedSamples) return;
+    const lines = traceHeader().concat(capturedSamples.map(sample => `${sample.timestamp},${sample.raw}`));
+    capturedSamples = null;
+    const link = document.createElement('a');
+    link.href = URL.createObjectURL(new Blob([lines.join('\n') + '\n'], { type: 'text/csv' }));
+    link.download = filename;
+    link.click();
+    setTimeout(() => URL.revokeObjectURL(link.href), 0);
+};
+
+function formatDuration(seconds) {
+    const minutes = Math.round(seconds / 60);
+    if (minutes < 60) return `${minutes}m`;
+    const hours = Math.floor(minutes / 60);
+    if (hours < 48) return `${hours}h ${minutes % 60}m`;
+    return `${Math.floor(hours / 24)}d ${hours % 24}h`;
+}
+
+function updateRateDisplay(data) {
+    if (data.rate === undefined) {
+        rateDisplay.textContent = '';
+        return;
+    }
+    let text = `${(-data.rate).toFixed(1)} g/h`;
+    if (data.eta !== undefined) {
+        text += `, empty in ${formatDuration(data.eta)}`;
+    }
+    rateDisplay.textContent = text;
+}
+
 function connectWebSocket() {
     if (ws && (ws.readyState === WebSocket.CONNECTING || ws.readyState === WebSocket.OPEN)) {
         return;
     }
     
     ws = new WebSocket(wsUrl);
+    ws.binaryType = 'arraybuffer';
     
     ws.onopen = () => {
         console.log('WebSocket connected');
@@ -56,28 +223,23 @@ function connectWebSocket() {
             clearInterval(reconnectInterval);
             reconnectInterval = null;
         }
-        // Small delay to ensure server is ready
-        setTimeout(() => {
-            // Request vessel list and calibration settings on connection
-            console.log('Requesting initial data');
+        // The server pushes a snapshot of vessels, calibration and weight on connect
+        vesselVersion = null;
+        try {
+            ws.send(JSON.stringify({ command: 'setFormat', format: 'binary' }));
+            ws.send(JSON.stringify({ command: 'setTime', time: Math.floor(Date.now() / 1000) }));
+        } catch (e) {
+            console.error('Failed to send initial settings:', e);
+        }
+        // Restore updates state if it was enabled
+        if (updatesEnabled) {
+            console.log('Restoring updates state:', updatesEnabled);
             try {
-                ws.send(JSON.stringify({ command: 'getVessels' }));
-                ws.send(JSON.stringify({ command: 'getCalibrationSettings' }));
+                ws.send(JSON.stringify({ command: 'toggleUpdates', enabled: updatesEnabled }));
             } catch (e) {
-                console.error('Failed to request initial data:', e);
-                statusDisplay.textContent = 'Failed to load data';
-                statusDisplay.style.color = '#e74c3c';
-            }
-            // Restore updates state if it was enabled
-            if (updatesEnabled) {
-                console.log('Restoring updates state:', updatesEnabled);
-                try {
-                    ws.send(JSON.stringify({ command: 'toggleUpdates', enabled: updatesEnabled }));
-                } catch (e) {
-                    console.error('Failed to restore updates state:', e);
-                }
+                console.error('Failed to restore updates state:', e);
             }
-        }, 500); // 500ms delay
+        }
     };
     
     ws.onclose = () => {
@@ -103,12 +265,38 @@ function connectWebSocket() {
     
     ws.onmessage = (event) => {
         try {
-            const data = JSON.parse(event.data);
+            if (event.data instanceof ArrayBuffer && new DataView(event.data).getUint8(0) === STREAM_MAGIC) {
+                handleSampleBatch(event.data);
+                return;
+            }
+            const data = event.data instanceof ArrayBuffer ? decodeTelemetry(event.data) : JSON.parse(event.data);
+            if (!data) return;
+            if (data.stream) {
+                console.log('Sample stream:', data.stream);
+                return;
+            }
             console.log('Received message:', data);
+
+            if (data.snapshot) {
+                applySnapshot(data.snapshot);
+                return;
+            }
+            if (data.vesselDelta) {
+                applyVesselDelta(data.vesselDelta);
+                return;
+            }
+            if (data.vesselResync) {
+                if (data.vesselResync.version !== vesselVersion) requestVesselSync();
+                return;
+            }
             
-            if (updatesEnabled) {
+            if (updatesEnabled && forViewedChannel(data)) {
                 if (data.weight !== undefined) {
                     weightDisplay.textContent = `Total: ${data.weight.toFixed(2)}g`;
+                    updateRateDisplay(data);
+                }
+                if (data.stable !== undefined) {
+                    weightDisplay.classList.toggle('unstable', !data.stable);
                 }
                 if (data.filamentWeight !== undefined) {
                     filamentDisplay.textContent = `Filament: ${data.filamentWeight.toFixed(2)}g`;
@@ -123,25 +311,38 @@ function connectWebSocket() {
             }
             
             if (data.vessels) {
-                updateVesselsList(data.vessels);
-                // Update selected vessel if provided
-                if (data.selectedVessel !== undefined) {
-                    updateSelectedVessel(data.selectedVessel);
-                }
+                updateVesselsList(data);
+                // Update selected vessels if provided
+                applySelections(data);
             }
             
             if (data.status) {
                 statusDisplay.textContent = data.status;
                 console.log('Status update:', data.status);
-                // Refresh vessel list after successful operations
-                if (data.status.includes('Vessel')) {
-                    ws.send(JSON.stringify({ command: 'getVessels' }));
-                }
             }
 
             // Handle calibration settings
-            if (data.calibrationMargin !== undefined) {
-                calibrationMarginInput.value = (data.calibrationMargin * 100).toFixed(1);
+            if (forViewedChannel(data)) {
+                rememberConversionSettings(data);
+                if (data.calibrationMargin !== undefined) {
+                    calibrationMarginInput.value = (data.calibrationMargin * 100).toFixed(1);
+                }
+                if (data.calibrationPoints) {
+                    updateCalibrationPoints(data.calibrationPoints);
+                }
+                if (data.filter) {
+                    updateFilterSettings(data.filter);
+                }
+            }
+
+            // Calibration progress frames are only sent to the requesting client
+            if (data.calibration) {
+                const cal = data.calibration;
+                if (cal.state === 'settling') {
+                    statusDisplay.textContent = 'Calibrating... waiting for weight to settle';
+                } else if (cal.state === 'measuring') {
+                    statusDisplay.textContent = `Calibrating... ${Math.round(cal.progress * 100)}% (${cal.samples} readings)`;
+                }
             }
         } catch (e) {
             console.error('Error parsing message:', e);
@@ -155,6 +356,35 @@ function connectWebSocket() {
     };
 }
 
+// Messages without a channel are about the first load cell
+function forViewedChannel(data) {
+    return (data.channel || 0) === viewedChannel;
+}
+
+function updateChannelSelect(count) {
+    channelCount = count;
+    if (viewedChannel >= channelCount) viewedChannel = 0;
+    channelSelect.innerHTML = '';
+    for (let channel = 0; channel < channelCount; channel++) {
+        const option = document.createElement('option');
+        option.value = channel;
+        option.textContent = `${channel + 1}`;
+        channelSelect.appendChild(option);
+    }
+    channelSelect.value = viewedChannel;
+    channelGroup.hidden = channelCount < 2;
+}
+
+// Show another load cell: its selection right away, calibration once the server sent it
+channelSelect.addEventListener('change', () => {
+    viewedChannel = parseInt(channelSelect.value);
+    updateSelectedVessel(selectedVessels[viewedChannel] ?? -1);
+    filamentDisplay.textContent = 'No vessel selected';
+    rateDisplay.textContent = '';
+    ws.send(JSON.stringify({ command: 'getCalibrationSettings', channel: viewedChannel }));
+    ws.send(JSON.stringify({ command: 'getCalibrationPoints', channel: viewedChannel }));
+});
+
 // Toggle real-time updates
 toggleUpdatesButton.addEventListener('click', () => {
     updatesEnabled = !updatesEnabled;
@@ -171,51 +401,144 @@ toggleUpdatesButton.addEventListener('click', () => {
 });
 
 // Vessel List Management
-function updateVesselsList(vessels) {
-    console.log('Updating vessels list:', vessels);
-    // Store current selection to restore it after updating list
-    const selectedVessel = vesselsList.querySelector('.vessel-item.selected');
-    const selectedIndex = selectedVessel ? Array.from(vesselsList.children).indexOf(selectedVessel) : -1;
+// Vessels arrive in pages sorted by name; each page carries the cursor for the
+// next one. After that the server sends versioned deltas, and a client that
+// missed one asks to be brought up to date from the last version it applied.
+const vessels = new Map();
+const selectedVessels = [];  // Vessel bound to each load cell
+let vesselVersion = null;  // null until the first page arrived
+let vesselSyncPending = false;
+
+// Same order as the server: case-insensitive name, then exact name, then id
+function compareVessels(a, b) {
+    const nameA = a.name.toLowerCase();
+    const nameB = b.name.toLowerCase();
+    if (nameA !== nameB) return nameA < nameB ? -1 : 1;
+    if (a.name !== b.name) return a.name < b.name ? -1 : 1;
+    return a.id - b.id;
+}
+
+function renderVessels() {
     vesselsList.innerHTML = '';
-    vessels.forEach((vessel, index) => {
+    Array.from(vessels.values()).sort(compareVessels).forEach(vessel => {
         const vesselElement = document.createElement('div');
         vesselElement.className = 'vessel-item';
+        vesselElement.dataset.id = vessel.id;
         
         vesselElement.innerHTML = `
             <div class="vessel-info">
-                <h3>${vessel.name}</h3>
+                <h3></h3>
                 <p>Vessel: ${vessel.vesselWeight.toFixed(1)}g | Spool: ${vessel.spoolWeight.toFixed(1)}g</p>
             </div>
             <div class="vessel-actions">
-                <button onclick="selectVessel(${index})" class="button">Select</button>
-                <button onclick="editVessel(${index})" class="button">Edit</button>
-                <button onclick="deleteVessel(${index})" class="button">Delete</button>
+                <button onclick="selectVessel(${vessel.id})" class="button">Select</button>
+                <button onclick="editVessel(${vessel.id})" class="button">Edit</button>
+                <button onclick="deleteVessel(${vessel.id})" class="button">Delete</button>
             </div>
         `;
+        vesselElement.querySelector('h3').textContent = vessel.name;
         vesselsList.appendChild(vesselElement);
     });
+    updateSelectedVessel(selectedVessels[viewedChannel] ?? -1);
 }
 
-function updateSelectedVessel(index) {
-    // Remove selected class from all vessels
-    const vessels = vesselsList.getElementsByClassName('vessel-item');
-    Array.from(vessels).forEach(vessel => {
-        vessel.classList.remove('selected');
-    });
+function updateVesselsList(page) {
+    console.log('Updating vessels list:', page);
+    if (page.first) {
+        vessels.clear();
+        vesselVersion = page.version;
+        vesselSyncPending = false;
+    }
+    page.vessels.forEach(vessel => vessels.set(vessel.id, vessel));
+    renderVessels();
+
+    if (page.cursor) {
+        ws.send(JSON.stringify({ command: 'getVessels', after: page.cursor }));
+    }
+}
+
+function requestVesselSync() {
+    if (vesselSyncPending || vesselVersion === null) return;
+    vesselSyncPending = true;
+    ws.send(JSON.stringify({ command: 'syncVessels', since: vesselVersion }));
+}
+
+function applyVesselDelta(delta) {
+    // Deltas already covered by the list we have are skipped
+    if (vesselVersion === null || delta.version <= vesselVersion) return;
+    if (delta.version !== vesselVersion + 1) {
+        requestVesselSync();
+        return;
+    }
+    vesselVersion = delta.version;
+    vesselSyncPending = false;
 
-    // Add selected class to current vessel
-    if (index >= 0 && index < vessels.length) {
-        vessels[index].classList.add('selected');
+    switch (delta.op) {
+        case 'add':
+        case 'update':
+            // Missing if the vessel was deleted again before the delta went out
+            if (delta.vessel) vessels.set(delta.id, delta.vessel);
+            renderVessels();
+            break;
+        case 'delete':
+            vessels.delete(delta.id);
+            renderVessels();
+            break;
+        case 'select':
+            updateSelectedVessel(delta.id, delta.channel || 0);
+            break;
     }
 }
 
-function selectVessel(index) {
-    console.log('Selecting vessel:', index);
+// Weight and calibration in the snapshot are the first load cell's
+function applySnapshot(snapshot) {
+    updateChannelSelect(snapshot.channels || 1);
+    applySelections(snapshot);
+    updateVesselsList(snapshot);
+    updateFilterSettings(snapshot.filter);
+    if (viewedChannel !== 0) {
+        ws.send(JSON.stringify({ command: 'getCalibrationSettings', channel: viewedChannel }));
+        ws.send(JSON.stringify({ command: 'getCalibrationPoints', channel: viewedChannel }));
+        return;
+    }
+    weightDisplay.textContent = `Total: ${snapshot.weight.toFixed(2)}g`;
+    weightDisplay.classList.toggle('unstable', !snapshot.stable);
+    if (snapshot.filamentWeight !== undefined) {
+        filamentDisplay.textContent = `Filament: ${snapshot.filamentWeight.toFixed(2)}g`;
+    } else {
+        filamentDisplay.textContent = 'No vessel selected';
+    }
+    calibrationMarginInput.value = (snapshot.calibrationMargin * 100).toFixed(1);
+    updateCalibrationPoints(snapshot.calibrationPoints);
+    rememberConversionSettings(snapshot);
+}
+
+// Vessel pages carry every load cell's selection, or just the first one's
+function applySelections(page) {
+    if (page.selectedVessels) {
+        page.selectedVessels.forEach((id, channel) => updateSelectedVessel(id, channel));
+    } else if (page.selectedVessel !== undefined) {
+        updateSelectedVessel(page.selectedVessel, 0);
+    }
+}
+
+function updateSelectedVessel(id, channel = viewedChannel) {
+    selectedVessels[channel] = id;
+    if (channel !== viewedChannel) return;
+    const items = vesselsList.getElementsByClassName('vessel-item');
+    Array.from(items).forEach(item => {
+        item.classList.toggle('selected', Number(item.dataset.id) === id);
+    });
+}
+
+function selectVessel(id) {
+    console.log('Selecting vessel:', id);
     // Update UI immediately for better responsiveness
-    updateSelectedVessel(index);
+    updateSelectedVessel(id);
     ws.send(JSON.stringify({
         command: 'selectVessel',
-        index: index
+        id,
+        channel: viewedChannel
     }));
 }
 
@@ -224,7 +547,7 @@ function showModal(isEdit = false, vesselData = null) {
     console.log('Showing modal:', { isEdit, vesselData });
     modalTitle.textContent = isEdit ? 'Edit Vessel' : 'Add Vessel';
     vesselForm.reset();
-    document.getElementById('vessel-index').value = isEdit ? vesselData.index : '';
+    document.getElementById('vessel-id').value = isEdit ? vesselData.id : '';
     document.getElementById('vessel-name').value = isEdit ? vesselData.name : '';
     document.getElementById('vessel-weight').value = isEdit ? vesselData.vesselWeight : '';
     document.getElementById('spool-weight').value = isEdit ? vesselData.spoolWeight : '';
@@ -237,26 +560,20 @@ function hideModal() {
 }
 
 // Vessel CRUD Operations
-function editVessel(index) {
-    console.log('Editing vessel:', index);
-    const vesselElement = vesselsList.children[index];
-    const name = vesselElement.querySelector('h3').textContent;
-    const weights = vesselElement.querySelector('p').textContent.match(/\d+(\.\d+)?/g);
-    
-    showModal(true, {
-        index,
-        name,
-        vesselWeight: parseFloat(weights[0]),
-        spoolWeight: parseFloat(weights[1])
-    });
+function editVessel(id) {
+    console.log('Editing vessel:', id);
+    const vessel = vessels.get(id);
+    if (vessel) {
+        showModal(true, vessel);
+    }
 }
 
-function deleteVessel(index) {
-    console.log('Deleting vessel:', index);
+function deleteVessel(id) {
+    console.log('Deleting vessel:', id);
     if (confirm('Are you sure you want to delete this vessel?')) {
         ws.send(JSON.stringify({
             command: 'deleteVessel',
-            index
+            id
         }));
     }
 }
@@ -268,7 +585,8 @@ saveMarginButton.addEventListener('click', () => {
         const margin = marginPercent / 100;
         ws.send(JSON.stringify({
             command: 'setCalibrationMargin',
-            margin: margin
+            margin: margin,
+            channel: viewedChannel
         }));
     } else {
         statusDisplay.textContent = 'Invalid margin (must be between 0.1% and 10%)';
@@ -276,10 +594,58 @@ saveMarginButton.addEventListener('click', () => {
     }
 });
 
+// Multi-point calibration
+function updateCalibrationPoints(points) {
+    calibrationPointsList.innerHTML = '';
+    if (points.length === 0) {
+        calibrationPointsList.innerHTML = '<li>Single-factor calibration</li>';
+        return;
+    }
+    points.forEach(point => {
+        const item = document.createElement('li');
+        item.textContent = `${point.weight.toFixed(1)}g = ${point.counts.toFixed(0)} counts`;
+        calibrationPointsList.appendChild(item);
+    });
+}
+
+addCalibrationPointButton.addEventListener('click', () => {
+    const weight = prompt('Place a known weight on the scale and enter it in grams:', '500');
+    if (weight) {
+        ws.send(JSON.stringify({ command: 'addCalibrationPoint', weight: parseFloat(weight), channel: viewedChannel }));
+    }
+});
+
+clearCalibrationPointsButton.addEventListener('click', () => {
+    if (confirm('Clear all calibration points?')) {
+        ws.send(JSON.stringify({ command: 'clearCalibrationPoints', channel: viewedChannel }));
+    }
+});
+
+// Filter settings handling
+function updateFilterSettings(filter) {
+    Object.keys(filterInputs).forEach(stage => {
+        if (filter[stage]) {
+            const inputs = filterInputs[stage];
+            inputs.enabled.checked = filter[stage].enabled;
+            inputs.value.value = filter[stage][inputs.key];
+        }
+    });
+}
+
+saveFilterButton.addEventListener('click', () => {
+    Object.keys(filterInputs).forEach(stage => {
+        const inputs = filterInputs[stage];
+        // Shared by all load cells; the channel only picks whose settings come back
+        const message = { command: 'setFilter', stage, enabled: inputs.enabled.checked, channel: viewedChannel };
+        message[inputs.key] = parseFloat(inputs.value.value);
+        ws.send(JSON.stringify(message));
+    });
+});
+
 // Event Listeners
 tareButton.addEventListener('click', () => {
     if (ws && ws.readyState === WebSocket.OPEN) {
-        ws.send(JSON.stringify({ command: 'tare' }));
+        ws.send(JSON.stringify({ command: 'tare', channel: viewedChannel }));
         statusDisplay.textContent = 'Taring...';
     }
 });
@@ -290,7 +656,8 @@ calibrateButton.addEventListener('click', () => {
         if (weight) {
             ws.send(JSON.stringify({
                 command: 'calibrate',
-                weight: parseFloat(weight)
+                weight: parseFloat(weight),
+                channel: viewedChannel
             }));
         }
     }
@@ -303,14 +670,14 @@ window.deleteVessel = deleteVessel;
 // Vessel Form Submission
 vesselForm.addEventListener('submit', (event) => {
     event.preventDefault();
-    const index = document.getElementById('vessel-index').value;
+    const id = document.getElementById('vessel-id').value;
     const name = document.getElementById('vessel-name').value;
     const vesselWeight = Math.round(parseFloat(document.getElementById('vessel-weight').value) * 10) / 10;
     const spoolWeight = Math.round(parseFloat(document.getElementById('spool-weight').value) * 10) / 10;
 
     const data = {
-        command: index ? 'updateVessel' : 'addVessel',
-        index: index ? parseInt(index) : undefined,
+        command: id ? 'updateVessel' : 'addVessel',
+        id: id ? parseInt(id) : undefined,
         vessel: {
             name,
             vesselWeight,
@@ -0,0 +1,256 @@
+#pragma once
+// Host implementation of the Arduino and FreeRTOS APIs the firmware logic
+// uses, for the native PlatformIO environment. Tasks are threads, task
+// notifications are condition variables, critical sections are spinlocks
+// and time is the host's monotonic clock.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define F_CPU 160000000L
+#define IRAM_ATTR
+
+// ---- Time
+
+inline uint64_t nativeMicros() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() { return (unsigned long)(nativeMicros() / 1000); }
+inline unsigned long micros() { return (unsigned long)nativeMicros(); }
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+inline void delayMicroseconds(uint32_t us) {
+    // Short waits spin like the hardware delay does; sleeping would overshoot by far more
+    uint64_t end = nativeMicros() + us;
+    while (nativeMicros() < end) {
+    }
+}
+
+// ---- Print / Serial
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) write(data[i]);
+        return length;
+    }
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+    size_t println() { return print("\n"); }
+    template <class T> size_t println(T value) { return print(value) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        if ((size_t)length < sizeof(buffer)) return write((const uint8_t*)buffer, length);
+
+        std::string large(length + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&large[0], large.size(), format, args);
+        va_end(args);
+        return write((const uint8_t*)large.data(), length);
+    }
+};
+
+// stdout, and stdin for the serial console
+class NativeSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* data, size_t length) override { return fwrite(data, 1, length, stdout); }
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() { fflush(stdout); }
+};
+
+inline NativeSerial Serial;
+
+// ---- String
+
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    explicit String(int n) : value(std::to_string(n)) {}
+    explicit String(unsigned n) : value(std::to_string(n)) {}
+    explicit String(long n) : value(std::to_string(n)) {}
+    explicit String(unsigned long n) : value(std::to_string(n)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    size_t length() const { return value.size(); }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    friend String operator+(const char* a, const String& b) { return String(std::string(a) + b.value); }
+    friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+
+    int indexOf(char c, unsigned from = 0) const {
+        size_t pos = value.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned from, unsigned to) const { return String(value.substr(from, to - from)); }
+    String substring(unsigned from) const { return String(value.substr(from)); }
+    char charAt(unsigned i) const { return i < value.size() ? value[i] : '\0'; }
+    bool endsWith(const String& suffix) const {
+        return value.size() >= suffix.value.size() &&
+               value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+    }
+
+private:
+    std::string value;
+};
+
+// ---- ESP
+
+class NativeEsp {
+public:
+    uint32_t getCpuFreqMHz() const { return F_CPU / 1000000; }
+};
+
+inline NativeEsp ESP;
+
+// ---- FreeRTOS
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xFFFFFFFFu
+// 1 kHz tick, as on the ESP32 Arduino core
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+struct NativeTask {
+    std::mutex mutex;
+    std::condition_variable wake;
+    uint32_t notifications = 0;
+};
+
+typedef NativeTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline NativeTask*& nativeCurrentTask() {
+    thread_local NativeTask* task = nullptr;
+    return task;
+}
+
+// The main thread and other plain threads get a task record on first use
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    NativeTask*& task = nativeCurrentTask();
+    if (!task) task = new NativeTask();
+    return task;
+}
+
+// Only a task deleting itself is supported; its thread ends when the task function returns
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+    NativeTask* task = new NativeTask();
+    if (handle) *handle = task;
+    std::thread([fn, arg, task]() {
+        nativeCurrentTask() = task;
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->wake.notify_one();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotifyGive(task);
+    if (woken) *woken = pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    NativeTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto notified = [task]() { return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) {
+        task->wake.wait(lock, notified);
+    } else {
+        task->wake.wait_for(lock, std::chrono::milliseconds(ticks), notified);
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+// Spinlock standing in for portMUX; copying yields a fresh unlocked one
+struct portMUX_TYPE {
+    portMUX_TYPE() : locked(false) {}
+    portMUX_TYPE(const portMUX_TYPE&) : locked(false) {}
+    portMUX_TYPE& operator=(const portMUX_TYPE&) {
+        locked.store(false);
+        return *this;
+    }
+    std::atomic<bool> locked;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE()
+
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) {
+    while (mux->locked.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) {
+    mux->locked.store(false, std::memory_order_release);
+}
+
+typedef std::timed_mutex* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::timed_mutex(); }
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        semaphore->lock();
+        return pdTRUE;
+    }
+    return semaphore->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    semaphore->unlock();
+    return pdTRUE;
+}
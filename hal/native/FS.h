@@ -0,0 +1,123 @@
+#pragma once
+// Host implementation of the Arduino fs::FS / fs::File API, backed by a
+// directory on the workstation. Paths are relative to that directory.
+#include <Arduino.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File {
+public:
+    File() {}
+    File(FILE* handle, const std::string& path)
+        : handle(handle, [](FILE* f) { if (f) fclose(f); }), path(path) {}
+
+    explicit operator bool() const { return handle != nullptr; }
+
+    size_t read(uint8_t* buffer, size_t length) {
+        return handle ? fread(buffer, 1, length, handle.get()) : 0;
+    }
+
+    int read() {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t length) {
+        return handle ? fwrite(buffer, 1, length, handle.get()) : 0;
+    }
+
+    bool seek(uint32_t position) {
+        return handle && fseek(handle.get(), position, SEEK_SET) == 0;
+    }
+
+    size_t position() const {
+        return handle ? ftell(handle.get()) : 0;
+    }
+
+    size_t size() const {
+        if (!handle) return 0;
+        struct stat info;
+        fflush(handle.get());
+        return fstat(fileno(handle.get()), &info) == 0 ? info.st_size : 0;
+    }
+
+    int available() {
+        return handle ? (int)(size() - position()) : 0;
+    }
+
+    String readStringUntil(char terminator) {
+        std::string line;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) line += (char)c;
+        return String(line);
+    }
+
+    const char* name() const {
+        size_t slash = path.rfind('/');
+        return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+    void flush() {
+        if (handle) fflush(handle.get());
+    }
+
+    void close() {
+        handle.reset();
+    }
+
+private:
+    std::shared_ptr<FILE> handle;
+    std::string path;
+};
+
+class FS {
+public:
+    explicit FS(const std::string& root) : root(root) {
+        mkdir(root.c_str(), 0755);
+    }
+
+    // Modes as on the device: "r", "r+", "w", "a"
+    File open(const char* path, const char* mode = "r") {
+        std::string mapped = map(path);
+        std::string fopenMode = std::string(mode) + "b";
+        FILE* handle = fopen(mapped.c_str(), fopenMode.c_str());
+        return handle ? File(handle, mapped) : File();
+    }
+
+    File open(const String& path, const char* mode = "r") {
+        return open(path.c_str(), mode);
+    }
+
+    bool exists(const char* path) {
+        struct stat info;
+        return stat(map(path).c_str(), &info) == 0;
+    }
+
+    bool exists(const String& path) {
+        return exists(path.c_str());
+    }
+
+    bool remove(const char* path) {
+        return ::remove(map(path).c_str()) == 0;
+    }
+
+    bool rename(const char* pathFrom, const char* pathTo) {
+        return ::rename(map(pathFrom).c_str(), map(pathTo).c_str()) == 0;
+    }
+
+private:
+    std::string map(const char* path) const {
+        return root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+    std::string root;
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
@@ -0,0 +1,157 @@
+#pragma once
+// Host implementation of the ESP32 Preferences (NVS) API. Each namespace is
+// kept in memory and written back to "<dir>/<namespace>.nvs" after every
+// change; the directory is set once with Preferences::setStorageDir(), and
+// without one nothing is saved.
+#include <Arduino.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    Preferences() : readOnly(false), started(false) {}
+
+    static void setStorageDir(const std::string& dir) {
+        storageDir() = dir;
+    }
+
+    bool begin(const char* name, bool readOnly = false) {
+        ns = name;
+        this->readOnly = readOnly;
+        started = true;
+        load();
+        return true;
+    }
+
+    void end() {
+        started = false;
+    }
+
+    bool clear() {
+        if (!writable()) return false;
+        entries.clear();
+        return save();
+    }
+
+    bool remove(const char* key) {
+        if (!writable()) return false;
+        entries.erase(key);
+        return save();
+    }
+
+    bool isKey(const char* key) {
+        return started && entries.count(key) > 0;
+    }
+
+    size_t getBytesLength(const char* key) {
+        auto it = entries.find(key);
+        return started && it != entries.end() ? it->second.size() : 0;
+    }
+
+    size_t getBytes(const char* key, void* buffer, size_t length) {
+        auto it = entries.find(key);
+        if (!started || it == entries.end() || it->second.size() > length) return 0;
+        memcpy(buffer, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t length) {
+        if (!writable()) return 0;
+        entries[key].assign((const uint8_t*)value, (const uint8_t*)value + length);
+        return save() ? length : 0;
+    }
+
+    bool getBool(const char* key, bool fallback = false) { return get<uint8_t>(key, fallback) != 0; }
+    uint8_t getUChar(const char* key, uint8_t fallback = 0) { return get(key, fallback); }
+    uint16_t getUShort(const char* key, uint16_t fallback = 0) { return get(key, fallback); }
+    int32_t getInt(const char* key, int32_t fallback = 0) { return get(key, fallback); }
+    uint32_t getUInt(const char* key, uint32_t fallback = 0) { return get(key, fallback); }
+    float getFloat(const char* key, float fallback = 0.0f) { return get(key, fallback); }
+
+    size_t putBool(const char* key, bool value) { return put<uint8_t>(key, value ? 1 : 0); }
+    size_t putUChar(const char* key, uint8_t value) { return put(key, value); }
+    size_t putUShort(const char* key, uint16_t value) { return put(key, value); }
+    size_t putInt(const char* key, int32_t value) { return put(key, value); }
+    size_t putUInt(const char* key, uint32_t value) { return put(key, value); }
+    size_t putFloat(const char* key, float value) { return put(key, value); }
+
+    size_t putString(const char* key, const char* value) {
+        return putBytes(key, value, strlen(value) + 1);
+    }
+
+    size_t getString(const char* key, char* buffer, size_t length) {
+        auto it = entries.find(key);
+        if (!started || it == entries.end() || length == 0) return 0;
+        size_t n = it->second.size() < length ? it->second.size() : length;
+        memcpy(buffer, it->second.data(), n);
+        buffer[n - 1] = '\0';
+        return n;
+    }
+
+private:
+    static std::string& storageDir() {
+        static std::string dir;
+        return dir;
+    }
+
+    template <class T>
+    T get(const char* key, T fallback) {
+        T value;
+        return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) == sizeof(T) ? value : fallback;
+    }
+
+    template <class T>
+    size_t put(const char* key, T value) {
+        return putBytes(key, &value, sizeof(T));
+    }
+
+    bool writable() const {
+        return started && !readOnly;
+    }
+
+    std::string path() const {
+        return storageDir() + "/" + ns + ".nvs";
+    }
+
+    // File format: repeated (key length u8, key, value length u16, value)
+    void load() {
+        entries.clear();
+        if (storageDir().empty()) return;
+        FILE* file = fopen(path().c_str(), "rb");
+        if (!file) return;
+        uint8_t keyLength;
+        while (fread(&keyLength, 1, 1, file) == 1) {
+            std::string key(keyLength, '\0');
+            uint16_t valueLength;
+            if (fread(&key[0], 1, keyLength, file) != keyLength ||
+                fread(&valueLength, sizeof(valueLength), 1, file) != 1) break;
+            std::vector<uint8_t> value(valueLength);
+            if (valueLength > 0 && fread(value.data(), 1, valueLength, file) != valueLength) break;
+            entries[key] = value;
+        }
+        fclose(file);
+    }
+
+    bool save() {
+        if (storageDir().empty()) return true;
+        FILE* file = fopen(path().c_str(), "wb");
+        if (!file) return false;
+        for (const auto& entry : entries) {
+            uint8_t keyLength = entry.first.size();
+            uint16_t valueLength = entry.second.size();
+            fwrite(&keyLength, 1, 1, file);
+            fwrite(entry.first.data(), 1, keyLength, file);
+            fwrite(&valueLength, sizeof(valueLength), 1, file);
+            fwrite(entry.second.data(), 1, valueLength, file);
+        }
+        fclose(file);
+        return true;
+    }
+
+    std::string ns;
+    bool readOnly;
+    bool started;
+    std::map<std::string, std::vector<uint8_t>> entries;
+};
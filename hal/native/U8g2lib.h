@@ -0,0 +1,149 @@
+#pragma once
+// Host implementation of the U8g2 full-buffer API used by DisplayRenderer.
+//
+// The buffer uses the SSD1306 page layout (8 tile rows of 128 bytes, one
+// byte per column of 8 pixels), so the renderer's dirty-row tracking works
+// unchanged. updateDisplayArea() copies tiles to a simulated panel, and when
+// a dump path is set writes the panel as <path>.pbm together with the text
+// drawn into the frame as <path>.txt. There is no font data: every glyph is
+// drawn as a filled cell of the font's size, which keeps layouts (widths,
+// overlaps, clipping) checkable while the text itself goes to the .txt file.
+// Rotation is ignored.
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Font stand-ins: glyph width, glyph height (ascent above the baseline)
+static const uint8_t u8g2_font_6x10_tr[] = {6, 10};
+static const uint8_t u8g2_font_7x13_tr[] = {7, 13};
+static const uint8_t u8g2_font_7x14_tr[] = {7, 14};
+static const uint8_t u8g2_font_7x14B_tr[] = {7, 14};
+static const uint8_t u8g2_font_logisoso16_tr[] = {10, 16};
+
+struct u8g2_cb_t {};
+static const u8g2_cb_t u8g2_cb_r2 = {};
+#define U8G2_R2 (&u8g2_cb_r2)
+#define U8X8_PIN_NONE 255
+
+class U8G2 {
+public:
+    static constexpr uint8_t WIDTH = 128;
+    static constexpr uint8_t HEIGHT = 64;
+    static constexpr uint8_t TILE_WIDTH = WIDTH / 8;
+    static constexpr uint8_t TILE_HEIGHT = HEIGHT / 8;
+
+    U8G2() : font(u8g2_font_6x10_tr) {
+        memset(buffer, 0, sizeof(buffer));
+        memset(panel, 0, sizeof(panel));
+    }
+
+    // Frames are written to <path>.pbm / <path>.txt from then on; nullptr stops dumping
+    static void setDumpPath(const char* path) {
+        dumpPath() = path ? path : "";
+    }
+
+    // Tiles sent to the panel so far, across all instances
+    static uint32_t tilesSent() {
+        return tileCounter();
+    }
+
+    void setBusClock(uint32_t) {}
+    bool begin() { return true; }
+    void setContrast(uint8_t) {}
+
+    void clearBuffer() {
+        memset(buffer, 0, sizeof(buffer));
+        text.clear();
+    }
+
+    void setFont(const uint8_t* newFont) {
+        font = newFont;
+    }
+
+    int getStrWidth(const char* s) const {
+        return strlen(s) * font[0];
+    }
+
+    // x, y is the left end of the baseline, as in U8g2
+    int drawStr(int x, int y, const char* s) {
+        char line[96];
+        snprintf(line, sizeof(line), "%d,%d %s\n", x, y, s);
+        text += line;
+
+        for (const char* c = s; *c; c++, x += font[0]) {
+            if (*c == ' ') continue;
+            for (int gy = y - font[1] + 1; gy <= y; gy++) {
+                for (int gx = x; gx < x + font[0] - 1; gx++) drawPixel(gx, gy);
+            }
+        }
+        return getStrWidth(s);
+    }
+
+    void drawPixel(int x, int y) {
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return;
+        buffer[(y / 8) * WIDTH + x] |= 1 << (y % 8);
+    }
+
+    uint8_t* getBufferPtr() { return buffer; }
+    uint8_t getBufferTileWidth() const { return TILE_WIDTH; }
+    uint8_t getBufferTileHeight() const { return TILE_HEIGHT; }
+
+    void sendBuffer() {
+        updateDisplayArea(0, 0, TILE_WIDTH, TILE_HEIGHT);
+    }
+
+    void updateDisplayArea(uint8_t tx, uint8_t ty, uint8_t tw, uint8_t th) {
+        for (uint8_t row = ty; row < ty + th && row < TILE_HEIGHT; row++) {
+            memcpy(panel + row * WIDTH + tx * 8, buffer + row * WIDTH + tx * 8, tw * 8);
+        }
+        tileCounter() += tw * th;
+        dump();
+    }
+
+private:
+    static std::string& dumpPath() {
+        static std::string path;
+        return path;
+    }
+
+    static uint32_t& tileCounter() {
+        static uint32_t tiles = 0;
+        return tiles;
+    }
+
+    void dump() const {
+        if (dumpPath().empty()) return;
+        FILE* file = fopen((dumpPath() + ".pbm").c_str(), "w");
+        if (file) {
+            fprintf(file, "P1\n%d %d\n", WIDTH, HEIGHT);
+            for (int y = 0; y < HEIGHT; y++) {
+                for (int x = 0; x < WIDTH; x++) {
+                    fputc(panel[(y / 8) * WIDTH + x] & (1 << (y % 8)) ? '1' : '0', file);
+                }
+                fputc('\n', file);
+            }
+            fclose(file);
+        }
+        file = fopen((dumpPath() + ".txt").c_str(), "w");
+        if (file) {
+            fputs(text.c_str(), file);
+            fclose(file);
+        }
+    }
+
+    const uint8_t* font;
+    uint8_t buffer[WIDTH * HEIGHT / 8];
+    uint8_t panel[WIDTH * HEIGHT / 8];  // What the simulated panel shows
+    std::string text;                   // Strings drawn since clearBuffer()
+};
+
+class U8G2_SSD1306_128X64_NONAME_F_HW_I2C : public U8G2 {
+public:
+    U8G2_SSD1306_128X64_NONAME_F_HW_I2C(const u8g2_cb_t*, uint8_t reset = U8X8_PIN_NONE,
+                                        uint8_t clock = U8X8_PIN_NONE, uint8_t data = U8X8_PIN_NONE) {
+        (void)reset;
+        (void)clock;
+        (void)data;
+    }
+};
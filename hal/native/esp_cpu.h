@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for the CPU cycle counter, derived from the monotonic clock at F_CPU
+#include <Arduino.h>
+
+inline uint32_t esp_cpu_get_cycle_count() {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (uint32_t)(ns * (F_CPU / 1000000) / 1000);
+}
@@ -0,0 +1,191 @@
+#pragma once
+// Scriptable load cell for the native build.
+//
+// Wraps the virtual-time SimHx711 and keeps it level with the host clock
+// from a ticker thread, so the real sampling task, ready "interrupt" and
+// filters run against it unchanged. The weight on the platform is either
+// fixed or a function of seconds since setProfile(); it is converted to counts
+// with a zero offset and sensitivity like a real cell, plus optional
+// Gaussian noise. A second, fixed weight sits on input B, which the chip
+// reads at a quarter of the input A gain.
+#include <Arduino.h>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "sim/hx711_sim.h"
+
+class SimLoadCell {
+public:
+    typedef std::function<float(float seconds)> WeightProfile;
+
+    explicit SimLoadCell(float countsPerGram = 420.0f, int32_t zeroCounts = 85000,
+                         uint32_t conversionPeriodUs = SimHx711::PERIOD_10SPS_US)
+        : chip(conversionPeriodUs), countsPerGram(countsPerGram), zeroCounts(zeroCounts),
+          noiseCounts(0.0f), grams(0.0f), gramsB(0.0f), profileStartUs(0), startUs(0), running(false) {
+        chip.setValueSource(conversion, this);
+    }
+
+    void setWeight(float weight) {
+        std::lock_guard<std::mutex> lock(mutex);
+        profile = nullptr;
+        grams = weight;
+    }
+
+    void setWeightB(float weight) {
+        std::lock_guard<std::mutex> lock(mutex);
+        gramsB = weight;
+    }
+
+    void setProfile(WeightProfile fn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        profile = fn;
+        profileStartUs = running ? nativeMicros() - startUs : 0;
+    }
+
+    // Standard deviation of the noise added to every conversion
+    void setNoise(float counts) {
+        std::lock_guard<std::mutex> lock(mutex);
+        noiseCounts = counts;
+    }
+
+    float getCountsPerGram() const { return countsPerGram; }
+    int32_t getZeroCounts() const { return zeroCounts; }
+
+    SimHx711::Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chip.getStats();
+    }
+
+    // Starts the clock; repeated calls are ignored
+    void begin() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        startUs = nativeMicros();
+        std::thread([this]() { tickerLoop(); }).detach();
+    }
+
+    bool readDout() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chip.dout();
+    }
+
+    bool clockBit() {
+        std::lock_guard<std::mutex> lock(mutex);
+        chip.setSck(true);
+        chip.advance(1);
+        bool bit = chip.dout();
+        chip.setSck(false);
+        chip.advance(1);
+        return bit;
+    }
+
+    void attachReadyInterrupt(void (*isr)(void*), void* arg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chip.onFallingEdge(isr, arg);
+    }
+
+    void detachReadyInterrupt() {
+        std::lock_guard<std::mutex> lock(mutex);
+        chip.onFallingEdge(nullptr, nullptr);
+    }
+
+    void setReadyInterruptEnabled(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chip.setFallingEdgeEnabled(enabled);
+    }
+
+private:
+    static constexpr uint32_t TICK_US = 1000;
+
+    // Called by the chip with the mutex held; gainPulses selected this conversion's input
+    static int32_t conversion(uint64_t timeUs, uint8_t gainPulses, void* arg) {
+        SimLoadCell* cell = static_cast<SimLoadCell*>(arg);
+        float weight = cell->profile ? cell->profile((timeUs - cell->profileStartUs) / 1e6f) : cell->grams;
+        float gain = 1.0f;
+        if (gainPulses == 2) {
+            weight = cell->gramsB;
+            gain = 0.25f;
+        } else if (gainPulses == 3) {
+            gain = 0.5f;
+        }
+        float counts = (cell->zeroCounts + weight * cell->countsPerGram) * gain;
+        if (cell->noiseCounts > 0) {
+            counts += std::normal_distribution<float>(0.0f, cell->noiseCounts)(cell->random);
+        }
+        return (int32_t)lroundf(counts);
+    }
+
+    // Bit-banged reads move the chip slightly ahead of the host clock; it then waits
+    void tickerLoop() {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::microseconds(TICK_US));
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t now = nativeMicros() - startUs;
+            if (now > chip.now()) chip.advance(now - chip.now());
+        }
+    }
+
+    std::mutex mutex;
+    SimHx711 chip;
+    float countsPerGram;
+    int32_t zeroCounts;
+    float noiseCounts;
+    float grams;
+    float gramsB;
+    WeightProfile profile;
+    uint64_t profileStartUs;    // Chip time
+    std::mt19937 random;
+    uint64_t startUs;
+    bool running;
+};
+
+// Hx711Driver Io policy on load cells sharing a clock line, one lane each.
+// Every cell runs on its own clock, like chips with separate oscillators.
+class SimLoadCellIo {
+public:
+    SimLoadCellIo(SimLoadCell* cells, uint8_t count) : cells(cells), count(count) {}
+
+    void begin() {
+        for (uint8_t i = 0; i < count; i++) cells[i].begin();
+    }
+
+    uint8_t lanes() const { return count; }
+
+    uint32_t readDout() {
+        uint32_t levels = 0;
+        for (uint8_t i = 0; i < count; i++) levels |= (cells[i].readDout() ? 1u : 0u) << i;
+        return levels;
+    }
+
+    uint32_t clockBit() {
+        uint32_t levels = 0;
+        for (uint8_t i = 0; i < count; i++) levels |= (cells[i].clockBit() ? 1u : 0u) << i;
+        return levels;
+    }
+
+    void attachReadyInterrupt(void (*isr)(void*), void* arg) {
+        for (uint8_t i = 0; i < count; i++) cells[i].attachReadyInterrupt(isr, arg);
+    }
+
+    void detachReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) cells[i].detachReadyInterrupt();
+    }
+
+    void disableReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) cells[i].setReadyInterruptEnabled(false);
+    }
+
+    void enableReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) cells[i].setReadyInterruptEnabled(true);
+    }
+
+private:
+    SimLoadCell* cells;
+    uint8_t count;
+};
+
+// One cell per HX711_DATA_PINS entry, read by the Scale in the native build;
+// defined by the host program
+extern SimLoadCell loadCells[];
@@ -0,0 +1,253 @@
+// Host micro-benchmarks of the per-tick work (pio run -e bench).
+//
+// Each benchmark repeats one operation until it has run for at least
+// MIN_TIME_MS and reports the time and heap allocations per operation. Only
+// allocations made on the benchmarking thread are counted, so the vessel
+// store's background writes don't show up in the caller's numbers.
+//
+//   program [results.json]
+//
+// The JSON file is what tools/bench_compare.py diffs between two commits.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+#include <Preferences.h>
+#include <stdlib.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "vessel_manager.h"
+#include "display_ui.h"
+#include "scale.h"
+#include "telemetry.h"
+#include "json_messages.h"
+#include "weight_filter.h"
+#include "metrics.h"
+#include "profiler.h"
+
+SimLoadCell loadCells[HX711_CHIPS];
+Scale* scale;
+VesselManager* vesselManager;
+Metrics metrics;
+#if PROFILER_ENABLED
+Profiler profiler;
+#endif
+
+// ---- Allocation counting
+
+static thread_local uint64_t allocations = 0;
+static thread_local uint64_t allocatedBytes = 0;
+
+// Out of line, so GCC doesn't pair the inlined malloc() with a delete it
+// can't see through and warn about mismatched allocation functions
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocations++;
+    allocatedBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+[[gnu::noinline]] void* operator new[](size_t size) { return operator new(size); }
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ---- Harness
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+static const uint64_t MIN_TIME_MS = 200;
+static std::vector<Result> results;
+
+// Keeps the compiler from dropping a result nobody reads
+template <class T>
+inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <class Fn>
+static void benchmark(const char* name, Fn fn) {
+    fn(0);
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t allocsBefore = allocations;
+        uint64_t bytesBefore = allocatedBytes;
+        uint64_t start = nativeMicros();
+        for (uint64_t i = 0; i < iterations; i++) fn(i);
+        uint64_t elapsedUs = nativeMicros() - start;
+
+        if (elapsedUs >= MIN_TIME_MS * 1000) {
+            Result result = {name, iterations, elapsedUs * 1000.0 / iterations,
+                             (double)(allocations - allocsBefore) / iterations,
+                             (double)(allocatedBytes - bytesBefore) / iterations};
+            Serial.printf("%-24s %12llu %12.1f %10.2f %10.1f\n", name, (unsigned long long)iterations,
+                          result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+            results.push_back(result);
+            return;
+        }
+        iterations *= elapsedUs < MIN_TIME_MS * 100 ? 10 : 2;
+    }
+}
+
+static bool writeResults(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "{\"benchmarks\":[");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(file, "%s\n{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}",
+                i ? "," : "", r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+// ---- Benchmarks
+
+static void weightBenchmarks() {
+    ScaleChannel* tableScale = new ScaleChannel();
+    tableScale->setCalibrationFactor(loadCells[0].getCountsPerGram());
+    CalibrationTable::Point points[] = {{42000.0f, 100.0f}, {210500.0f, 500.0f},
+                                        {421800.0f, 1000.0f}, {846000.0f, 2000.0f}};
+    tableScale->loadCalibrationTable(points, sizeof(points) / sizeof(points[0]));
+
+    benchmark("weight.to_grams", [](uint64_t i) {
+        keep(scale->channel(0).toWeight(85000.0f + (i & 0xFFFF)));
+    });
+    benchmark("weight.to_grams_table", [tableScale](uint64_t i) {
+        keep(tableScale->toWeight(85000.0f + (i & 0xFFFF) * 8));
+    });
+
+    FilterChain filters;
+    benchmark("weight.filter", [&filters](uint64_t i) {
+        keep(filters.process(85000.0f + (i & 0xFF)));
+    });
+}
+
+static void displayBenchmarks(DisplayUI& display, const VesselConfig* vessel) {
+    char text[16];
+    benchmark("display.format_weight", [&text](uint64_t i) {
+        snprintf(text, sizeof(text), "%.1fg", 1234.5f + (i & 0xFF) * 0.1f);
+        keep(text);
+    });
+    // Every call moves the weight past the hysteresis, so every call formats a full view
+    benchmark("display.show_weight", [&display, vessel](uint64_t i) {
+        display.showWeight(1234.5f + (i & 0xFF) * 0.1f, vessel);
+    });
+}
+
+static void telemetryBenchmarks(const VesselConfig* vessel) {
+    TelemetrySnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.weight = 1234.5f;
+    snapshot.filamentWeight = 806.5f;
+    snapshot.rate = -12.3f;
+    snapshot.eta = 236000.0f;
+    snapshot.selectedVessel = vessel->id;
+    snapshot.stable = true;
+    snapshot.hasVessel = true;
+
+    char json[256];
+    benchmark("telemetry.json", [&](uint64_t i) {
+        snapshot.weight = 1234.5f + (i & 0xFF) * 0.1f;
+        keep(encodeJsonTelemetry(snapshot, vessel, json, sizeof(json)));
+    });
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    benchmark("telemetry.binary", [&](uint64_t i) {
+        snapshot.weight = 1234.5f + (i & 0xFF) * 0.1f;
+        keep(encodeBinaryTelemetry(snapshot, frame));
+    });
+}
+
+static void vesselBenchmarks(const std::vector<uint16_t>& ids) {
+    // What sendVesselPage() and the connect snapshot do, into a heap string like String
+    benchmark("vessels.page_json", [](uint64_t) {
+        StaticJsonDocument<3072> doc;
+        fillVesselPage(doc.to<JsonObject>(), *vesselManager, vesselManager->getVersion(), "", 0, VESSEL_PAGE_SIZE, true);
+        std::string json;
+        serializeJson(doc, json);
+        keep(json);
+    });
+    // The caller's side of saving: index upkeep and staging for the background writer
+    benchmark("vessels.update", [&ids](uint64_t i) {
+        uint16_t id = ids[i % ids.size()];
+        VesselConfig vessel = {};
+        vesselManager->getVessel(id, vessel);
+        vesselManager->updateVessel(id, vessel.name, 180.0f + (i & 0xF), vessel.spoolWeight);
+    });
+    benchmark("vessels.rename", [&ids](uint64_t i) {
+        char name[32];
+        snprintf(name, sizeof(name), "Spool %03u", (unsigned)(i % 1000));
+        uint16_t id = ids[i % ids.size()];
+        VesselConfig vessel = {};
+        vesselManager->getVessel(id, vessel);
+        vesselManager->updateVessel(id, name, vessel.vesselWeight, vessel.spoolWeight);
+    });
+    benchmark("vessels.select", [&ids](uint64_t i) {
+        vesselManager->setSelectedVessel(ids[i % ids.size()]);
+    });
+}
+
+// Removed however main() returns
+struct ScratchDir {
+    char path[32] = "/tmp/filament-bench-XXXXXX";
+
+    bool create() { return mkdtemp(path) != nullptr; }
+
+    ~ScratchDir() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+};
+
+int main(int argc, char** argv) {
+    ScratchDir scratch;
+    if (!scratch.create()) {
+        Serial.println("Failed to create a scratch directory");
+        return 1;
+    }
+    const char* dir = scratch.path;
+    Preferences::setStorageDir(dir);
+    FS flash(std::string(dir) + "/fs");
+
+    // Constructed but never started: nothing samples in the background
+    scale = new Scale();
+    scale->channel(0).setCalibrationFactor(loadCells[0].getCountsPerGram());
+
+    vesselManager = new VesselManager(flash);
+    std::vector<uint16_t> ids;
+    for (int i = 0; i < 100; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Spool %03d", (i * 37) % 100);
+        ids.push_back(vesselManager->addVessel(name, 180.0f, 250.0f));
+    }
+    DisplayUI display;
+    VesselConfig first = {};
+    vesselManager->getVessel(ids[0], first);
+    const VesselConfig* vessel = &first;
+
+    Serial.printf("%-24s %12s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+    weightBenchmarks();
+    displayBenchmarks(display, vessel);
+    telemetryBenchmarks(vessel);
+    vesselBenchmarks(ids);
+
+    const char* path = argc > 1 ? argv[1] : "bench.json";
+    if (!writeResults(path)) {
+        Serial.printf("Failed to write %s\n", path);
+        return 1;
+    }
+    Serial.printf("Results written to %s\n", path);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <atomic>
+#include "config.h"
+#include "scale.h"
+
+// Calibration measurement driven from loop(), either for the single
+// calibration factor or for one point of the multi-point correction table
+// of one load cell channel. One channel is calibrated at a time.
+//
+// The job waits for the scale to settle, then accumulates raw readings from
+// the sample ring with running statistics. It finishes as soon as the spread
+// of the readings is within the calibration margin (same meaning as before:
+// (max - min) / mean) and the mean is known precisely enough, and otherwise
+// judges whatever it has collected when CALIBRATION_TIMEOUT_MS runs out.
+//
+// The WebSocket task only files a request(); loop() starts it with
+// startPending() once the previous job has been finished, so the job's
+// fields are only ever written by loop().
+class Calibration {
+public:
+    // FACTOR sets the single calibration factor, POINT adds an entry to the correction table
+    enum Mode {
+        FACTOR,
+        POINT
+    };
+
+    enum State {
+        IDLE,
+        SETTLING,
+        MEASURING,
+        SUCCEEDED,
+        FAILED
+    };
+
+    static constexpr uint32_t MIN_SAMPLES = 5;
+    static constexpr uint32_t CALIBRATION_TIMEOUT_MS = 5000;
+    // Converged once the 95% confidence interval of the mean is this fraction of the margin
+    static constexpr float CONFIDENCE_FRACTION = 0.25f;
+
+    Calibration() : mode(FACTOR), state(IDLE), channel(0), knownWeight(0.0f), clientId(0), startTime(0), lastSeq(0), factor(0.0f),
+                    requestPending(false) {
+        requestMux = portMUX_INITIALIZER_UNLOCKED;
+        resetStats();
+    }
+
+    // Any task. Fails while a job is running or another request is waiting.
+    bool request(float weight, uint32_t requestingClient, Mode newMode = FACTOR, uint8_t onChannel = 0) {
+        if (weight <= 0) return false;
+        portENTER_CRITICAL(&requestMux);
+        bool accepted = !requestPending && !isActive();
+        if (accepted) {
+            pending.weight = weight;
+            pending.clientId = requestingClient;
+            pending.mode = newMode;
+            pending.channel = onChannel;
+            requestPending = true;
+        }
+        portEXIT_CRITICAL(&requestMux);
+        return accepted;
+    }
+
+    // loop() only. Starts the requested job once the previous one is finished.
+    bool startPending() {
+        if (state != IDLE) return false;
+        portENTER_CRITICAL(&requestMux);
+        bool haveRequest = requestPending;
+        Request next = pending;
+        requestPending = false;
+        portEXIT_CRITICAL(&requestMux);
+        return haveRequest && start(next.weight, next.clientId, next.mode, next.channel);
+    }
+
+    // loop() only
+    bool start(float weight, uint32_t requestingClient, Mode newMode = FACTOR, uint8_t onChannel = 0) {
+        if (isActive() || weight <= 0) return false;
+        mode = newMode;
+        channel = onChannel;
+        knownWeight = weight;
+        clientId = requestingClient;
+        startTime = millis();
+        factor = 0.0f;
+        resetStats();
+        state = SETTLING;
+        return true;
+    }
+
+    bool isActive() const {
+        return state == SETTLING || state == MEASURING;
+    }
+
+    // Consume new samples of the channel being calibrated. Returns true when there is progress to report.
+    bool update(ScaleChannel& scale) {
+        if (!isActive()) return false;
+        bool timedOut = millis() - startTime > CALIBRATION_TIMEOUT_MS;
+
+        if (state == SETTLING) {
+            if (scale.isStable()) {
+                // The settled stability window already holds usable readings
+                Sample window[STABILITY_WINDOW];
+                size_t n = scale.getSamples().copyLatest(window, STABILITY_WINDOW);
+                for (size_t i = 0; i < n; i++) {
+                    addReading(window[i].raw - scale.getOffset());
+                }
+                lastSeq = n > 0 ? window[n - 1].seq : scale.getSamples().headSeq();
+                state = MEASURING;
+            } else if (timedOut) {
+                state = FAILED;
+                return true;
+            } else {
+                return false;
+            }
+        } else {
+            uint32_t head = scale.getSamples().headSeq();
+            if (head == lastSeq && !timedOut) return false;
+            for (uint32_t seq = lastSeq + 1; (int32_t)(head - seq) >= 0; seq++) {
+                Sample sample;
+                if (scale.getSamples().read(seq, sample)) {
+                    addReading(sample.raw - scale.getOffset());
+                }
+            }
+            lastSeq = head;
+        }
+
+        float margin = scale.getCalibrationMargin();
+        if (getSpread() > margin) {
+            if (timedOut) {
+                state = FAILED;
+            } else {
+                // Load still moving: start over with the next readings
+                resetStats();
+            }
+            return true;
+        }
+
+        if ((count >= MIN_SAMPLES && getConfidence() <= margin * CONFIDENCE_FRACTION) ||
+            (timedOut && count >= 2)) {
+            factor = mean / knownWeight;
+            state = factor > 0 ? SUCCEEDED : FAILED;
+        } else if (timedOut) {
+            state = FAILED;
+        }
+        return true;
+    }
+
+    // Back to IDLE once the caller has handled SUCCEEDED/FAILED
+    void finish() {
+        state = IDLE;
+    }
+
+    // Relative spread of the readings, (max - min) / mean
+    float getSpread() const {
+        if (count < 2 || mean == 0.0f) return 0.0f;
+        return (maxReading - minReading) / fabsf(mean);
+    }
+
+    // Relative half-width of the 95% confidence interval of the mean
+    float getConfidence() const {
+        if (count < 2 || mean == 0.0f) return INFINITY;
+        float stderrMean = sqrtf(m2 / (count - 1) / count);
+        return 1.96f * stderrMean / fabsf(mean);
+    }
+
+    float getProgress() const {
+        switch (state) {
+            case SUCCEEDED:
+                return 1.0f;
+            case MEASURING: {
+                float bySamples = (float)count / MIN_SAMPLES;
+                float byTime = (float)(millis() - startTime) / CALIBRATION_TIMEOUT_MS;
+                float progress = bySamples > byTime ? bySamples : byTime;
+                return progress < 0.99f ? progress : 0.99f;
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    const char* getStateName() const {
+        switch (state) {
+            case SETTLING: return "settling";
+            case MEASURING: return "measuring";
+            case SUCCEEDED: return "done";
+            case FAILED: return "failed";
+            default: return "idle";
+        }
+    }
+
+    Mode getMode() const { return mode; }
+    State getState() const { return state; }
+    uint8_t getChannel() const { return channel; }
+    uint32_t getClientId() const { return clientId; }
+    uint32_t getSampleCount() const { return count; }
+    float getKnownWeight() const { return knownWeight; }
+    float getMeanReading() const { return mean; }
+    float getFactor() const { return factor; }
+    unsigned long getElapsed() const { return millis() - startTime; }
+
+private:
+    void resetStats() {
+        count = 0;
+        mean = 0.0f;
+        m2 = 0.0f;
+        minReading = INFINITY;
+        maxReading = -INFINITY;
+    }
+
+    void addReading(float reading) {
+        count++;
+        float delta = reading - mean;
+        mean += delta / count;
+        m2 += delta * (reading - mean);
+        if (reading < minReading) minReading = reading;
+        if (reading > maxReading) maxReading = reading;
+    }
+
+    struct Request {
+        float weight;
+        uint32_t clientId;
+        Mode mode;
+        uint8_t channel;
+    };
+
+    Mode mode;
+    std::atomic<State> state;  // Read by the WebSocket task through isActive()
+    uint8_t channel;
+    float knownWeight;
+    uint32_t clientId;
+    unsigned long startTime;
+    uint32_t lastSeq;
+    float factor;
+
+    uint32_t count;
+    float mean;
+    float m2;
+    float minReading;
+    float maxReading;
+
+    portMUX_TYPE requestMux;
+    Request pending;
+    bool requestPending;  // Guarded by requestMux
+};
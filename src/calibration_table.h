@@ -0,0 +1,122 @@
+#pragma once
+#include <stdint.h>
+
+// Piecewise-linear correction from tared ADC counts to grams.
+//
+// The table holds up to MAX_POINTS captured (counts, grams) pairs plus the
+// implicit tare point (0, 0). Slopes are precomputed when points change, so
+// converting a reading is a binary search and one multiply-add. Readings
+// outside the captured range extrapolate along the nearest segment.
+class CalibrationTable {
+public:
+    static constexpr uint8_t MAX_POINTS = 8;
+
+    struct Point {
+        float counts;  // Raw reading with the tare offset removed
+        float grams;
+    };
+
+    CalibrationTable() : count(0) {
+        rebuild();
+    }
+
+    // Adds a point, replacing any existing point within MERGE_GRAMS of the same weight.
+    // Fails if the table is full or the point would make the curve non-monotonic.
+    bool addPoint(float counts, float grams) {
+        if (grams <= 0 || counts <= 0) return false;
+
+        Point updated[MAX_POINTS];
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            float diff = points[i].grams - grams;
+            if (diff > -MERGE_GRAMS && diff < MERGE_GRAMS) continue;
+            updated[n++] = points[i];
+        }
+        if (n >= MAX_POINTS) return false;
+
+        // Insert sorted by weight
+        uint8_t pos = n;
+        while (pos > 0 && updated[pos - 1].grams > grams) {
+            updated[pos] = updated[pos - 1];
+            pos--;
+        }
+        updated[pos].counts = counts;
+        updated[pos].grams = grams;
+        n++;
+
+        // More weight must always mean more counts
+        for (uint8_t i = 1; i < n; i++) {
+            if (updated[i].counts <= updated[i - 1].counts) return false;
+        }
+
+        for (uint8_t i = 0; i < n; i++) points[i] = updated[i];
+        count = n;
+        rebuild();
+        return true;
+    }
+
+    // Replace the whole table, e.g. from Preferences. Invalid input clears it.
+    bool load(const Point* source, uint8_t n) {
+        clear();
+        if (n > MAX_POINTS) return false;
+        for (uint8_t i = 0; i < n; i++) {
+            if (!addPoint(source[i].counts, source[i].grams)) {
+                clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear() {
+        count = 0;
+        rebuild();
+    }
+
+    bool isEmpty() const { return count == 0; }
+    uint8_t size() const { return count; }
+    const Point& getPoint(uint8_t index) const { return points[index]; }
+    const Point* data() const { return points; }
+
+    float apply(float counts) const {
+        if (count == 0) return 0.0f;
+        // Last knot at or below counts; knot 0 is the tare point
+        uint8_t lo = 0;
+        uint8_t hi = count;
+        while (lo < hi) {
+            uint8_t mid = (lo + hi + 1) / 2;
+            if (knots[mid].counts <= counts) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        uint8_t segment = lo < count ? lo : count - 1;
+        return knots[segment].grams + (counts - knots[segment].counts) * slopes[segment];
+    }
+
+    // Average sensitivity over the captured range
+    float countsPerGram() const {
+        if (count == 0) return 0.0f;
+        return points[count - 1].counts / points[count - 1].grams;
+    }
+
+private:
+    static constexpr float MERGE_GRAMS = 1.0f;
+
+    void rebuild() {
+        knots[0].counts = 0.0f;
+        knots[0].grams = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            knots[i + 1] = points[i];
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            slopes[i] = (knots[i + 1].grams - knots[i].grams) / (knots[i + 1].counts - knots[i].counts);
+        }
+    }
+
+    Point points[MAX_POINTS];
+    Point knots[MAX_POINTS + 1];
+    float slopes[MAX_POINTS];
+    uint8_t count;
+};
@@ -1,34 +1,86 @@
 #pragma once
+#include <stdint.h>
 
 // Pin Definitions
 #define ROTARY_PIN_RIGHT    0  // D0 - Left
 #define ROTARY_PIN_BUTTON   1  // D1 - Push
 #define ROTARY_PIN_LEFT     2  // D2 - Right
 
-// HX711 pins
-#define HX711_DATA_PIN   19
+// HX711 pins. Every HX711 shares the clock pin and has its own data pin; list
+// up to 8 data pins (below GPIO 32) to read a rack of load cells in lockstep,
+// e.g. -DHX711_DATA_PINS=19,18,17,21
 #define HX711_CLOCK_PIN  20
+#ifndef HX711_DATA_PINS
+#define HX711_DATA_PINS  19
+#endif
+// 1 also reads a second load cell on input B (gain 32) of every HX711
+#ifndef HX711_INPUT_B
+#define HX711_INPUT_B    0
+#endif
+
+static constexpr uint8_t HX711_DATA_PIN_LIST[] = {HX711_DATA_PINS};
+#define HX711_CHIPS      ((uint8_t)sizeof(HX711_DATA_PIN_LIST))
+// One channel per load cell: chip by chip, input A then input B
+#define SCALE_CHANNELS   (HX711_CHIPS * (HX711_INPUT_B ? 2 : 1))
 
 // I2C pins for OLED
 #define I2C_SDA         22
 #define I2C_SCL         23
 
+// Weight is considered settled once the standard deviation of the last
+// STABILITY_WINDOW filtered samples drops below STABILITY_THRESHOLD grams
+#define STABILITY_WINDOW      8
+#define STABILITY_THRESHOLD   0.3f
+// Raw counts used instead while a channel is uncalibrated (factor 1, no table),
+// where the gram threshold would be a fraction of a count; about 0.5 g on a
+// typical 1 kg load cell and well above the HX711's own noise
+#define STABILITY_RAW_THRESHOLD 200.0f
+#define STABILITY_TIMEOUT_MS  3000
+
+// Consumption rate is fitted over this many 5 s buckets (10 minutes)
+#define RATE_WINDOW_BUCKETS   120
+
+// Section timing histograms and loop stall logging; 0 compiles the probes out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED      0
+#endif
+// A loop() iteration taking longer than this is logged with its slowest section
+#define PROFILER_LOOP_BUDGET_US 20000
+
 // OLED Display settings
 #define SCREEN_WIDTH    128
 #define SCREEN_HEIGHT   64
 #define OLED_RESET     -1
 #define SCREEN_ADDRESS  0x3C
+// The render task draws at most this many frames per second
+#define DISPLAY_MAX_FPS     10
+// SSD1306 is specified for 400 kHz fast-mode I2C; many panels also run at 1 MHz
+#define DISPLAY_I2C_CLOCK   400000
+// Shown weight only changes once the reading moves by at least this many grams;
+// off by default, e.g. -DDISPLAY_HYSTERESIS=0.05f in build_flags turns it on
+#ifndef DISPLAY_HYSTERESIS
+#define DISPLAY_HYSTERESIS  0.0f
+#endif
+// With several channels the main screen moves on to the next one this often (0 = knob only)
+#define DISPLAY_CHANNEL_CYCLE_MS 5000
 
 // WiFi settings
 #define WIFI_AP_SSID    "FilamentScale"
 #define WIFI_AP_PASS    "scalewifi"
+// Time server for history timestamps (station mode only)
+#define NTP_SERVER      "pool.ntp.org"
 
 // Maximum number of vessel configurations
-#define MAX_VESSELS     10
+#define MAX_VESSELS     500
+// Vessels per page of the WebSocket vessel listing
+#define VESSEL_PAGE_SIZE 16
+// Vessels included in the snapshot sent when a WebSocket client connects
+#define SNAPSHOT_VESSELS 8
 
 // Structure for vessel configuration
 struct VesselConfig {
     char name[32];
     float vesselWeight;
     float spoolWeight;
+    uint16_t id;        // Stable identifier, never reused while the vessel exists; 0 = none
 };
@@ -0,0 +1,333 @@
+#pragma once
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <string.h>
+#include "config.h"
+#include "metrics.h"
+#include "profiler.h"
+
+#define ttype U8G2_SSD1306_128X64_NONAME_F_HW_I2C
+
+enum ViewScreen {
+    VIEW_MESSAGE,
+    VIEW_MAIN,
+    VIEW_VESSEL_SELECT,
+    VIEW_QUICK_ADD,
+    VIEW_CALIBRATION
+};
+
+// Immutable snapshot of what one screen shows, with every value already
+// formatted. Two snapshots that compare equal render identical pixels.
+struct ViewModel {
+    ViewScreen screen;
+    union {
+        struct {
+            char line1[32];
+            char line2[40];
+            bool bold;
+        } message;
+        struct {
+            char status[32];
+            char ip[40];
+            char name[32];
+            char weight[16];
+            char filament[32];
+            char rate[12];      // Consumption, empty until estimated
+            char eta[12];       // Time until the vessel is empty
+            char channel[8];    // "2/4" with several load cells, empty with one
+            bool hasVessel;
+        } main;
+        struct {
+            char channel[8];
+            bool quickAdd;
+            char name[32];
+            char vesselWeight[32];
+            char spoolWeight[32];
+        } vesselSelect;
+        struct {
+            uint8_t step;
+            char vesselWeight[32];
+        } quickAdd;
+        struct {
+            char title[32];
+            char weight[16];
+        } calibration;
+    };
+
+    // Zeroed so snapshots can be compared with memcmp
+    explicit ViewModel(ViewScreen screen) {
+        memset(static_cast<void*>(this), 0, sizeof(*this));
+        this->screen = screen;
+    }
+};
+
+// Owns the U8g2 instance and the I2C bus. Callers submit view models from
+// any task; the render task draws the newest one at most DISPLAY_MAX_FPS
+// times a second, drops snapshots that were superseded before being drawn
+// and skips frames identical to what the panel already shows.
+class DisplayRenderer {
+public:
+    DisplayRenderer()
+        : display(ttype(U8G2_R2, /* reset=*/ U8X8_PIN_NONE, I2C_SCL, I2C_SDA)),
+          pending(VIEW_MESSAGE), pendingValid(false), lastRendered(VIEW_MESSAGE), lastRenderedValid(false),
+          shadowValid(false), lastFrameTime(0), renderTask(nullptr) {
+        mux = portMUX_INITIALIZER_UNLOCKED;
+    }
+
+    void begin() {
+        xTaskCreate(renderTaskEntry, "render", RENDER_TASK_STACK, this, RENDER_TASK_PRIORITY, &renderTask);
+    }
+
+    // Never blocks on I2C; a newer snapshot replaces one that hasn't been drawn yet
+    void submit(const ViewModel& view) {
+        portENTER_CRITICAL(&mux);
+        pending = view;
+        pendingValid = true;
+        portEXIT_CRITICAL(&mux);
+        if (renderTask) xTaskNotifyGive(renderTask);
+    }
+
+private:
+    static constexpr uint32_t RENDER_TASK_STACK = 4096;
+    static constexpr UBaseType_t RENDER_TASK_PRIORITY = 1;
+    static constexpr uint32_t MIN_FRAME_INTERVAL_MS = 1000 / DISPLAY_MAX_FPS;
+
+    static void renderTaskEntry(void* arg) {
+        static_cast<DisplayRenderer*>(arg)->renderLoop();
+    }
+
+    void renderLoop() {
+        display.setBusClock(DISPLAY_I2C_CLOCK);
+        display.begin();
+        display.setContrast(255);
+
+        for (;;) {
+            if (!pendingValid) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+
+            // Frame-rate governor; anything submitted while waiting coalesces into one frame
+            unsigned long elapsed = millis() - lastFrameTime;
+            if (elapsed < MIN_FRAME_INTERVAL_MS) {
+                vTaskDelay(pdMS_TO_TICKS(MIN_FRAME_INTERVAL_MS - elapsed));
+            }
+
+            portENTER_CRITICAL(&mux);
+            bool haveFrame = pendingValid;
+            ViewModel view = pending;
+            pendingValid = false;
+            portEXIT_CRITICAL(&mux);
+
+            if (!haveFrame) continue;
+            if (lastRenderedValid && memcmp(&view, &lastRendered, sizeof(view)) == 0) continue;
+
+            uint32_t frameStart = micros();
+            render(view);
+            flush();
+            metrics.frameTime.observe(micros() - frameStart);
+            lastRendered = view;
+            lastRenderedValid = true;
+            lastFrameTime = millis();
+        }
+    }
+
+    void render(const ViewModel& view) {
+        PROFILE_SECTION(PROFILE_DISPLAY_RENDER);
+        display.clearBuffer();
+        switch (view.screen) {
+            case VIEW_MESSAGE:
+                renderMessage(view);
+                break;
+            case VIEW_MAIN:
+                renderMain(view);
+                break;
+            case VIEW_VESSEL_SELECT:
+                renderVesselSelect(view);
+                break;
+            case VIEW_QUICK_ADD:
+                renderQuickAdd(view);
+                break;
+            case VIEW_CALIBRATION:
+                renderCalibration(view);
+                break;
+        }
+    }
+
+    void renderMessage(const ViewModel& view) {
+        display.setFont(view.message.bold ? u8g2_font_7x14B_tr : u8g2_font_7x14_tr);
+        display.drawStr(0, 14, view.message.line1);
+        if (view.message.line2[0] != '\0') {
+            display.drawStr(0, 28, view.message.line2);
+        }
+    }
+
+    void renderMain(const ViewModel& view) {
+        int y = 14;
+
+        // Show WiFi status if it's set
+        if (view.main.status[0] != '\0') {
+            display.setFont(u8g2_font_7x13_tr);  // Smaller font for status
+            display.drawStr(0, y, view.main.status);
+            if (view.main.ip[0] != '\0') {
+                y += 13;
+                display.drawStr(0, y, view.main.ip);
+            }
+            y += 13;
+        }
+
+        // Show normal weight display
+        if (view.main.hasVessel) {
+            // Show vessel name, the channel right-aligned next to it
+            display.setFont(u8g2_font_7x14B_tr);
+            display.drawStr(0, y, view.main.name);
+            drawChannel(y, view.main.channel);
+            y += 2;
+
+            drawSeparator(y);
+            y += 20;
+
+            // Show total weight in large font
+            display.setFont(u8g2_font_logisoso16_tr);
+            display.drawStr(0, y, view.main.weight);
+
+            // Consumption rate and time to empty, small and right-aligned next to the weight
+            display.setFont(u8g2_font_6x10_tr);
+            if (view.main.rate[0] != '\0') {
+                display.drawStr(128 - display.getStrWidth(view.main.rate), y - 9, view.main.rate);
+            }
+            if (view.main.eta[0] != '\0') {
+                display.drawStr(128 - display.getStrWidth(view.main.eta), y + 1, view.main.eta);
+            }
+            y += 20;
+
+            // Show filament weight
+            display.setFont(u8g2_font_7x14_tr);
+            display.drawStr(0, y, view.main.filament);
+        } else {
+            // No vessel selected, show simple weight
+            display.setFont(u8g2_font_logisoso16_tr);
+            int strwidth = display.getStrWidth(view.main.weight);
+            display.drawStr((128 - strwidth) / 2, 40, view.main.weight);  // Center the weight
+
+            display.setFont(u8g2_font_7x14_tr);
+            display.drawStr(0, 60, "No vessel selected");
+            drawChannel(10, view.main.channel);
+        }
+    }
+
+    void drawChannel(int y, const char* channel) {
+        if (channel[0] == '\0') return;
+        display.setFont(u8g2_font_6x10_tr);
+        display.drawStr(128 - display.getStrWidth(channel), y, channel);
+    }
+
+    void renderVesselSelect(const ViewModel& view) {
+        display.setFont(u8g2_font_7x14B_tr);
+        int y = 14;
+
+        display.drawStr(0, y, "Select Vessel:");
+        drawChannel(y, view.vesselSelect.channel);
+        display.setFont(u8g2_font_7x14B_tr);
+        y += 3;
+
+        drawSeparator(y);
+        y += 13;
+
+        if (view.vesselSelect.quickAdd) {
+            display.drawStr(0, y, "[Quick Add Vessel]");
+        } else if (view.vesselSelect.name[0] != '\0') {
+            display.drawStr(0, y, view.vesselSelect.name);
+            y += 14;
+
+            display.setFont(u8g2_font_7x14_tr);
+            display.drawStr(0, y, view.vesselSelect.vesselWeight);
+            y += 14;
+
+            display.drawStr(0, y, view.vesselSelect.spoolWeight);
+        }
+    }
+
+    void renderQuickAdd(const ViewModel& view) {
+        display.setFont(u8g2_font_7x14B_tr);
+        int y = 14;
+        if (view.quickAdd.step == 0) {
+            display.drawStr(0, y, "Quick Add Vessel");
+            y += 20;
+            display.setFont(u8g2_font_7x14_tr);
+            display.drawStr(0, y, "Place empty vessel");
+            y += 20;
+            display.drawStr(0, y, "Press button when");
+            y += 15;
+            display.drawStr(0, y, "ready");
+        } else {
+            display.drawStr(0, y, "Add 1KG Spool");
+            y += 20;
+            display.setFont(u8g2_font_7x14_tr);
+            display.drawStr(0, y, view.quickAdd.vesselWeight);
+            y += 20;
+            display.drawStr(0, y, "Add full spool &");
+            y += 15;
+            display.drawStr(0, y, "press button");
+        }
+    }
+
+    void renderCalibration(const ViewModel& view) {
+        display.setFont(u8g2_font_7x14B_tr);
+        int y = 14;
+
+        display.drawStr(0, y, view.calibration.title);
+        y += 6;
+
+        drawSeparator(y);
+        y += 12;
+
+        display.setFont(u8g2_font_logisoso16_tr);
+        int strwidth = display.getStrWidth(view.calibration.weight);
+        display.drawStr((128 - strwidth) / 2, y, view.calibration.weight);  // Center the weight
+        y += 20;
+
+        display.setFont(u8g2_font_7x14_tr);
+        display.drawStr(0, y, "Press to save");
+    }
+
+    void drawSeparator(int y) {
+        for (int i = 0; i < 128; i += 2) {
+            display.drawPixel(i, y);
+        }
+    }
+
+    // Send only the tile rows whose pixels differ from what the panel already shows.
+    // Works on the raw buffer, so it is independent of the display rotation.
+    void flush() {
+        PROFILE_SECTION(PROFILE_DISPLAY_FLUSH);
+        uint8_t* buffer = display.getBufferPtr();
+        uint8_t tileWidth = display.getBufferTileWidth();
+        uint8_t tileHeight = display.getBufferTileHeight();
+        size_t rowBytes = tileWidth * 8;
+
+        int firstDirty = -1;
+        for (uint8_t row = 0; row <= tileHeight; row++) {
+            bool dirty = row < tileHeight &&
+                (!shadowValid || memcmp(buffer + row * rowBytes, shadow + row * rowBytes, rowBytes) != 0);
+            if (dirty && firstDirty < 0) {
+                firstDirty = row;
+            } else if (!dirty && firstDirty >= 0) {
+                display.updateDisplayArea(0, firstDirty, tileWidth, row - firstDirty);
+                firstDirty = -1;
+            }
+        }
+        memcpy(shadow, buffer, sizeof(shadow));
+        shadowValid = true;
+    }
+
+    ttype display;
+    portMUX_TYPE mux;
+    ViewModel pending;
+    volatile bool pendingValid;
+    ViewModel lastRendered;
+    bool lastRenderedValid;
+    uint8_t shadow[SCREEN_WIDTH * SCREEN_HEIGHT / 8];  // Copy of what the panel currently shows
+    bool shadowValid;
+    unsigned long lastFrameTime;
+    TaskHandle_t renderTask;
+};
@@ -1,5 +1,5 @@
 #pragma once
-#include <U8g2lib.h>
+#include "display_renderer.h"
 #include "vessel_manager.h"
 #include "scale.h"
 
@@ -14,18 +14,22 @@ enum MenuState {
     QUICK_ADD_VESSEL
 };
 
-#define ttype U8G2_SSD1306_128X64_NONAME_F_HW_I2C
-
 class DisplayUI {
 private:
     float quickAddWeight = 0.0f;
     int quickAddStep = 0;
+    bool quickAddCapturing = false;       // Button pressed, waiting for the reading to settle
+    unsigned long quickAddCaptureStart = 0;
     char tempVesselName[32];
 public:
-    DisplayUI() 
-    : display(ttype(U8G2_R2, /* reset=*/ U8X8_PIN_NONE, I2C_SCL, I2C_SDA)) {
+    DisplayUI() {
+        weightHysteresis = DISPLAY_HYSTERESIS;
+        displayedWeight = 0.0f;
+        displayedWeightValid = false;
         menuState = MAIN_SCREEN;
-        selectedVessel = vesselManager->getSelectedVessel();
+        channel = 0;
+        channelShownAt = millis();
+        selectedVessel = vesselManager->getSelectedVessel(channel);
         calibrationStep = 0;
         quickAddStep = 0;
         wifiStatus[0] = '\0';
@@ -33,81 +37,74 @@ public:
     }
     
     void init() {
-        display.begin();
-        display.clearBuffer();
-        display.setFont(u8g2_font_7x14B_tr);
-        display.setContrast(255);
-        display.drawStr(0, 14, "Initializing...");
-        display.sendBuffer();
+        renderer.begin();
+        ViewModel view(VIEW_MESSAGE);
+        strcpy(view.message.line1, "Initializing...");
+        view.message.bold = true;
+        renderer.submit(view);
     }
     
     void showWeight(float weight, const VesselConfig* vessel) {
         if (menuState != MAIN_SCREEN) return;
-        
-        display.clearBuffer();
-        char buf[32];
-        int y = 14;
 
-        // Show WiFi status if it's set
-        if (wifiStatus[0] != '\0') {
-            display.setFont(u8g2_font_7x13_tr);  // Smaller font for status
-            display.drawStr(0, y, wifiStatus);
-            if (ipAddress[0] != '\0') {
-                sprintf(buf, "IP: %s", ipAddress);
-                y += 13;
-                display.drawStr(0, y, buf);
-            }
-            y += 13;
+        // Only let the shown weight move once it has changed by more than the hysteresis
+        if (!displayedWeightValid || fabsf(weight - displayedWeight) >= weightHysteresis) {
+            displayedWeight = weight;
+            displayedWeightValid = true;
         }
+        weight = displayedWeight;
 
-        // Show normal weight display
+        // Format every region here; the renderer drops the frame if nothing changed
+        ViewModel view(VIEW_MAIN);
+        snprintf(view.main.status, sizeof(view.main.status), "%s", wifiStatus);
+        if (ipAddress[0] != '\0') {
+            snprintf(view.main.ip, sizeof(view.main.ip), "IP: %s", ipAddress);
+        }
+        snprintf(view.main.weight, sizeof(view.main.weight), "%.1fg", weight);
+        formatChannel(view.main.channel, sizeof(view.main.channel));
         if (vessel) {
-            // Show vessel name
-            display.setFont(u8g2_font_7x14B_tr);
-            display.drawStr(0, y, vessel->name);
-            y += 2;
-
-            // Separator line
-            for (int i = 0; i < 128; i += 2) {
-                display.drawPixel(i, y);
-            }
-            y += 20;
-
-            // Show total weight in large font
-            display.setFont(u8g2_font_logisoso16_tr);
-            sprintf(buf, "%.1fg", weight);
-            display.drawStr(0, y, buf);
-            y += 20;
-
-            // Show filament weight
-            display.setFont(u8g2_font_7x14_tr);
+            // Leave room for the channel at the end of the line
+            size_t nameLength = view.main.channel[0] != '\0' ? NAME_CHARS_WITH_CHANNEL : sizeof(view.main.name) - 1;
+            snprintf(view.main.name, sizeof(view.main.name), "%.*s", (int)nameLength, vessel->name);
             float filamentWeight = weight - vessel->vesselWeight - vessel->spoolWeight;
-            sprintf(buf, "Filament: %.1fg", filamentWeight);
-            display.drawStr(0, y, buf);
-        } else {
-            // No vessel selected, show simple weight
-            display.setFont(u8g2_font_logisoso16_tr);
-            sprintf(buf, "%.1fg", weight);
-            int strwidth = display.getStrWidth(buf);
-            display.drawStr((128 - strwidth) / 2, 40, buf);  // Center the weight
+            snprintf(view.main.filament, sizeof(view.main.filament), "Filament: %.1fg", filamentWeight);
 
-            display.setFont(u8g2_font_7x14_tr);
-            display.drawStr(0, 60, "No vessel selected");
+            float rate = scale->channel(channel).getConsumptionRate();
+            if (!isnan(rate)) {
+                snprintf(view.main.rate, sizeof(view.main.rate), "%.1fg/h", -rate);
+                formatDuration(view.main.eta, sizeof(view.main.eta), secondsToEmpty(filamentWeight, rate));
+            }
         }
-        display.sendBuffer();
+        view.main.hasVessel = vessel != nullptr;
+        renderer.submit(view);
+    }
+
+    // 0 disables the hysteresis
+    void setWeightHysteresis(float grams) {
+        weightHysteresis = grams;
     }
     
     void handleRotary(int direction) {
         int newSelection;
+        VesselConfig vessel;
         switch(menuState) {
+            case MAIN_SCREEN:
+                // Step through the load cells
+                if (SCALE_CHANNELS > 1) {
+                    showChannel((channel + SCALE_CHANNELS + (direction > 0 ? 1 : -1)) % SCALE_CHANNELS);
+                }
+                break;
+
             case VESSEL_SELECT:
-                // Allow -1 for "Quick Add" option
-                newSelection = selectedVessel + direction;
+                // Scroll in name order; position -1 is the "Quick Add" option
+                newSelection = selectedVessel == -1 ? -1 : vesselManager->positionOf(selectedVessel);
+                newSelection += direction;
                 if (newSelection < -1) newSelection = vesselManager->getVesselCount() - 1;
                 if (newSelection >= vesselManager->getVesselCount()) newSelection = -1;
-                selectedVessel = newSelection;
+                // The table may have shrunk meanwhile; that lands on "Quick Add"
+                selectedVessel = newSelection != -1 && vesselManager->getVesselAt(newSelection, vessel) ? vessel.id : -1;
                 if (selectedVessel >= 0) {
-                    vesselManager->setSelectedVessel(selectedVessel);
+                    vesselManager->setSelectedVessel(selectedVessel, channel);
                 }
                 showVesselSelection();
                 break;
@@ -116,13 +113,20 @@ public:
             case CALIBRATION_SPOOL:
                 // Handle calibration adjustment
                 break;
+
+            case QUICK_ADD_VESSEL:
+                // Steps are confirmed with the button
+                break;
         }
     }
     
     void handleButton() {
         switch(menuState) {
             case MAIN_SCREEN:
+                // Pick the vessel for the channel on screen
                 menuState = VESSEL_SELECT;
+                selectedVessel = vesselManager->getSelectedVessel(channel);
+                if (selectedVessel == 0) selectedVessel = -1;
                 showVesselSelection();
                 break;
             case VESSEL_SELECT:
@@ -131,10 +135,13 @@ public:
                     menuState = QUICK_ADD_VESSEL;
                     quickAddStep = 0;
                     showQuickAdd(0);
-                } else if (vesselManager->getVessel(selectedVessel)) {
-                    menuState = MAIN_SCREEN;
-                    vesselManager->setSelectedVessel(selectedVessel); // Persist selection
-                    showWeight(0.0, vesselManager->getVessel(selectedVessel)); // Show selected vessel immediately
+                } else {
+                    VesselConfig vessel;
+                    if (vesselManager->getVessel(selectedVessel, vessel)) {
+                        menuState = MAIN_SCREEN;
+                        vesselManager->setSelectedVessel(selectedVessel, channel); // Persist selection
+                        showWeight(0.0, &vessel); // Show selected vessel immediately
+                    }
                 }
                 break;
             case QUICK_ADD_VESSEL:
@@ -172,15 +179,12 @@ public:
         } else {
             ipAddress[0] = '\0';
         }
-        display.clearBuffer();
-        display.setFont(u8g2_font_7x14_tr);
-        display.drawStr(0, 14, wifiStatus);
+        ViewModel view(VIEW_MESSAGE);
+        strncpy(view.message.line1, wifiStatus, sizeof(view.message.line1) - 1);
         if (ipAddress[0] != '\0') {
-            char buf[32];
-            sprintf(buf, "IP: %s", ipAddress);
-            display.drawStr(0, 28, buf);
+            snprintf(view.message.line2, sizeof(view.message.line2), "IP: %s", ipAddress);
         }
-        display.sendBuffer();
+        renderer.submit(view);
     }
     
     void clearWiFiStatus() {
@@ -191,38 +195,68 @@ public:
     MenuState getMenuState() const { return menuState; }
     int getSelectedVessel() const { return selectedVessel; }
 
-    void setSelectedVessel(int index) {
-        if (index >= 0 && index < vesselManager->getVesselCount()) {
-            selectedVessel = index;
-            vesselManager->setSelectedVessel(index);
+    // Load cell shown on the main screen
+    uint8_t getChannel() const { return channel; }
+    unsigned long getChannelShownAt() const { return channelShownAt; }
+
+    void showChannel(uint8_t newChannel) {
+        channel = newChannel;
+        channelShownAt = millis();
+        VesselConfig vessel;
+        bool hasVessel = vesselManager->getSelectedVessel(channel, vessel);
+        selectedVessel = vesselManager->getSelectedVessel(channel);
+        displayedWeightValid = false;
+        showWeight(scale->channel(channel).getWeight(), hasVessel ? &vessel : nullptr);
+    }
+
+    // Bind a vessel to a channel and show that channel
+    void setSelectedVessel(int id, uint8_t forChannel = 0) {
+        if (vesselManager->hasVessel(id) && forChannel < SCALE_CHANNELS) {
+            vesselManager->setSelectedVessel(id, forChannel);
             menuState = MAIN_SCREEN;
-            VesselConfig* vessel = vesselManager->getVessel(selectedVessel);
-            if (vessel) {
-                showWeight(0.0, vessel);
-            }
+            showChannel(forChannel);
         }
     }
 
     void handleQuickAddButton() {
+        // pumpQuickAdd() takes the reading once it settles; presses meanwhile are ignored
+        if (quickAddCapturing) return;
+        quickAddCapturing = true;
+        quickAddCaptureStart = millis();
+    }
+
+    // Called from loop(); completes a quick add step with the first settled
+    // reading, or the latest one once the wait timed out
+    void pumpQuickAdd() {
+        if (!quickAddCapturing) return;
+        ScaleChannel& cell = scale->channel(channel);
+        bool settled = cell.isStable();
+        if (!settled && millis() - quickAddCaptureStart <= Scale::STABILITY_TIMEOUT) return;
+        quickAddCapturing = false;
+        if (menuState != QUICK_ADD_VESSEL) return;
+
+        // Rounded to one decimal place
+        float weight = settled ? cell.getStableWeight() : cell.getWeight();
+        weight = roundf(weight * 10.0f) / 10.0f;
         switch(quickAddStep) {
             case 0: // Empty vessel weight
-                // Round to one decimal place
-                quickAddWeight = roundf(scale->getWeight() * 10.0f) / 10.0f;
+                quickAddWeight = weight;
                 quickAddStep++;
                 showQuickAdd(quickAddWeight);
                 break;
             case 1: // With full spool
-                float fullWeight = roundf(scale->getWeight() * 10.0f) / 10.0f;
                 float vesselWeight = quickAddWeight;
-                float spoolWeight = roundf((fullWeight - vesselWeight - 1000.0f) * 10.0f) / 10.0f;
+                float spoolWeight = roundf((weight - vesselWeight - 1000.0f) * 10.0f) / 10.0f;
                 // Generate a default name
                 int vesselNum = vesselManager->getVesselCount() + 1;
                 snprintf(tempVesselName, sizeof(tempVesselName), "Vessel %d", vesselNum);
-                if (vesselManager->addVessel(tempVesselName, vesselWeight, spoolWeight)) {
-                    selectedVessel = vesselManager->getVesselCount() - 1;
-                    vesselManager->setSelectedVessel(selectedVessel);
+                uint16_t id = vesselManager->addVessel(tempVesselName, vesselWeight, spoolWeight);
+                VesselConfig added;
+                if (id != 0 && vesselManager->getVessel(id, added)) {
+                    selectedVessel = id;
+                    vesselManager->setSelectedVessel(selectedVessel, channel);
                     menuState = MAIN_SCREEN;
-                    showWeight(0.0, vesselManager->getVessel(selectedVessel));
+                    showWeight(0.0, &added);
                 } else {
                     menuState = MAIN_SCREEN;
                     showWeight(0.0, nullptr);
@@ -231,102 +265,77 @@ public:
         }
     }
 
-    void showQuickAdd(float weight) {
-        display.clearBuffer();
-        display.setFont(u8g2_font_7x14B_tr);
-        char buf[32];
-        int y = 14;
-        if (quickAddStep == 0) {
-            display.drawStr(0, y, "Quick Add Vessel");
-            y += 20;
-            display.setFont(u8g2_font_7x14_tr);
-            display.drawStr(0, y, "Place empty vessel");
-            y += 20;
-            display.drawStr(0, y, "Press button when");
-            y += 15;
-            display.drawStr(0, y, "ready");
-        } else {
-            display.drawStr(0, y, "Add 1KG Spool");
-            y += 20;
-            display.setFont(u8g2_font_7x14_tr);
-            sprintf(buf, "Vessel: %.1fg", weight);
-            display.drawStr(0, y, buf);
-            y += 20;
-            display.drawStr(0, y, "Add full spool &");
-            y += 15;
-            display.drawStr(0, y, "press button");
-        }
+    bool isCapturing() const { return quickAddCapturing; }
 
-        display.sendBuffer();
+    void showQuickAdd(float weight) {
+        ViewModel view(VIEW_QUICK_ADD);
+        view.quickAdd.step = quickAddStep;
+        snprintf(view.quickAdd.vesselWeight, sizeof(view.quickAdd.vesselWeight), "Vessel: %.1fg", weight);
+        renderer.submit(view);
     }
 
 private:
-    void showVesselSelection() {
-        display.clearBuffer();
-        display.setFont(u8g2_font_7x14B_tr);
-        int y = 14;
+    // Vessel name characters that fit next to a "8/8" channel label
+    static constexpr size_t NAME_CHARS_WITH_CHANNEL = 15;
 
-        display.drawStr(0, y, "Select Vessel:");
-        y += 3;
+    // "2/4", 1-based like the labels on a rack; nothing with a single load cell
+    void formatChannel(char* out, size_t size) const {
+        if (SCALE_CHANNELS > 1) {
+            snprintf(out, size, "%u/%u", channel + 1, (unsigned)SCALE_CHANNELS);
+        }
+    }
 
-        // Separator line
-        for (int i = 0; i < 128; i += 2) {
-            display.drawPixel(i, y);
+    // Coarse enough that the frame only changes about once a minute
+    static void formatDuration(char* out, size_t size, float seconds) {
+        if (isnan(seconds)) {
+            out[0] = '\0';
+            return;
+        }
+        uint32_t minutes = (uint32_t)(seconds / 60.0f);
+        if (minutes < 60) {
+            snprintf(out, size, "%lum", (unsigned long)minutes);
+        } else if (minutes < 48 * 60) {
+            snprintf(out, size, "%luh%02lum", (unsigned long)(minutes / 60), (unsigned long)(minutes % 60));
+        } else {
+            snprintf(out, size, "%lud%02luh", (unsigned long)(minutes / 1440), (unsigned long)(minutes / 60 % 24));
         }
-        y += 13;
+    }
 
+    void showVesselSelection() {
+        ViewModel view(VIEW_VESSEL_SELECT);
+        formatChannel(view.vesselSelect.channel, sizeof(view.vesselSelect.channel));
         if (selectedVessel == -1) {
-            display.drawStr(0, y, "[Quick Add Vessel]");
+            view.vesselSelect.quickAdd = true;
         } else {
-            VesselConfig* vessel = vesselManager->getVessel(selectedVessel);
-            if (vessel) {
-                display.drawStr(0, y, vessel->name);
-                y += 14;
-
-                char buf[32];
-                display.setFont(u8g2_font_7x14_tr);
-                sprintf(buf, "Vessel: %.1fg", vessel->vesselWeight);
-                display.drawStr(0, y, buf);
-                y += 14;
-
-                sprintf(buf, "Spool: %.1fg", vessel->spoolWeight);
-                display.drawStr(0, y, buf);
+            VesselConfig vessel;
+            if (vesselManager->getVessel(selectedVessel, vessel)) {
+                snprintf(view.vesselSelect.name, sizeof(view.vesselSelect.name), "%s", vessel.name);
+                snprintf(view.vesselSelect.vesselWeight, sizeof(view.vesselSelect.vesselWeight),
+                         "Vessel: %.1fg", vessel.vesselWeight);
+                snprintf(view.vesselSelect.spoolWeight, sizeof(view.vesselSelect.spoolWeight),
+                         "Spool: %.1fg", vessel.spoolWeight);
             }
         }
-        display.sendBuffer();
+        renderer.submit(view);
     }
-    
+
     void showCalibration(float weight, const char* type) {
-        display.clearBuffer();
-        display.setFont(u8g2_font_7x14B_tr);
-        int y = 14;
-        
-        char buf[32];
-        sprintf(buf, "Calibrating %s", type);
-        display.drawStr(0, y, buf);
-        y += 6;
-        
-        // Separator line
-        for (int i = 0; i < 128; i += 2) {
-            display.drawPixel(i, y);
-        }
-        y += 12;
-        
-        display.setFont(u8g2_font_logisoso16_tr);
-        sprintf(buf, "%.1fg", weight);
-        int strwidth = display.getStrWidth(buf);
-        display.drawStr((128 - strwidth) / 2, y, buf);  // Center the weight
-        y += 20;
-        
-        display.setFont(u8g2_font_7x14_tr);
-        display.drawStr(0, y, "Press to save");
-        display.sendBuffer();
+        ViewModel view(VIEW_CALIBRATION);
+        snprintf(view.calibration.title, sizeof(view.calibration.title), "Calibrating %s", type);
+        snprintf(view.calibration.weight, sizeof(view.calibration.weight), "%.1fg", weight);
+        renderer.submit(view);
     }
 
-    ttype display;
+    DisplayRenderer renderer;
     MenuState menuState;
+    uint8_t channel;
+    unsigned long channelShownAt;
     int selectedVessel;
     int calibrationStep;
     char wifiStatus[32];
     char ipAddress[32];
+
+    float weightHysteresis;
+    float displayedWeight;
+    bool displayedWeightValid;
 };
@@ -0,0 +1,49 @@
+#pragma once
+#include <AsyncWebSocket.h>
+#include <string.h>
+
+// Small pool of shared, reference-counted WebSocket message buffers.
+//
+// A frame is encoded once into a pooled buffer and that buffer is queued on
+// every subscribed client; AsyncWebSocket counts the queued references and
+// the buffer becomes reusable once all of them have been sent. Buffers stay
+// locked so the library never frees them, which keeps the steady state free
+// of heap allocation. A buffer is only reallocated when the frame length
+// changes and no free buffer already has the right size.
+template <size_t N>
+class FramePool {
+public:
+    FramePool() {
+        for (size_t i = 0; i < N; i++) slots[i] = nullptr;
+    }
+
+    void begin(AsyncWebSocket& ws, size_t initialLength) {
+        for (size_t i = 0; i < N; i++) {
+            slots[i] = ws.makeBuffer(initialLength);
+            if (slots[i]) slots[i]->lock();
+        }
+    }
+
+    // Copy a frame into a buffer no client still references.
+    // Returns nullptr when every buffer is still queued somewhere.
+    AsyncWebSocketMessageBuffer* acquire(const uint8_t* data, size_t len) {
+        AsyncWebSocketMessageBuffer* free = nullptr;
+        for (size_t i = 0; i < N; i++) {
+            AsyncWebSocketMessageBuffer* slot = slots[i];
+            if (!slot || slot->count() != 0) continue;
+            if (slot->length() == len) {
+                free = slot;
+                break;
+            }
+            if (!free) free = slot;
+        }
+        if (!free) return nullptr;
+        if (free->length() != len && !free->reserve(len)) return nullptr;
+
+        memcpy(free->get(), data, len);
+        return free;
+    }
+
+private:
+    AsyncWebSocketMessageBuffer* slots[N];
+};
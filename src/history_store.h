@@ -0,0 +1,473 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// Round-robin weight history on the flash filesystem, RRD style.
+//
+// Readings are consolidated into fixed-resolution tiers (1 s for the last
+// hour, 1 min for the last week, 1 h for the last year); every finished
+// interval of one tier also feeds the next coarser one. Each tier is one
+// preallocated file of BLOCK_SIZE blocks used as a ring, so the files never
+// grow and old data is overwritten in place.
+//
+// A block covers up to RECORDS_PER_BLOCK consecutive intervals. Timestamps are
+// implicit (start time + index * resolution); a gap in time or a full block
+// starts a new block. Values are tenths of a gram, stored as zigzag varint
+// deltas from the previous record together with a vessel tag, so a steady
+// reading costs one byte. Each record is the filament weight of the selected
+// vessel (by id), or the total weight for vessel -1.
+//
+// Only the open block of each tier lives in RAM. It is written when it is
+// full or every FLUSH_INTERVAL_MS, which bounds flash writes to roughly one
+// block a minute.
+class HistoryStore {
+public:
+    static constexpr uint8_t TIER_COUNT = 3;
+    static constexpr size_t BLOCK_SIZE = 512;
+    static constexpr uint8_t RECORDS_PER_BLOCK = 60;
+    static constexpr uint32_t FLUSH_INTERVAL_MS = 5 * 60 * 1000;
+    // Readings are only recorded once the clock is plausibly set (2023-11-14)
+    static constexpr uint32_t MIN_VALID_TIME = 1700000000;
+
+    struct TierSpec {
+        const char* path;
+        uint32_t resolution;  // Seconds per record
+        uint16_t blocks;
+    };
+
+    struct Record {
+        uint32_t time;
+        int16_t vessel;     // Vessel id, -1 for none
+        float weight;
+    };
+
+    struct BlockHeader {
+        uint8_t magic;
+        uint8_t tier;
+        uint8_t count;      // Records in the block, 0 = unused
+        uint8_t reserved;
+        uint32_t seq;       // Increases by one per block written to this tier
+        uint32_t startTime;
+        int32_t first;      // First value in tenths of a gram
+        int16_t vessel;     // Vessel of the first record
+        uint16_t reserved2;
+    };
+
+    static const TierSpec& tierSpec(uint8_t tier) {
+        static const TierSpec specs[TIER_COUNT] = {
+            {"/hist_1s.bin", 1, 60},        // 1 hour
+            {"/hist_1m.bin", 60, 168},      // 7 days
+            {"/hist_1h.bin", 3600, 146},    // 365 days
+        };
+        return specs[tier];
+    }
+
+    // Tier with exactly this resolution in seconds, or -1
+    static int findTier(uint32_t resolution) {
+        for (uint8_t i = 0; i < TIER_COUNT; i++) {
+            if (tierSpec(i).resolution == resolution) return i;
+        }
+        return -1;
+    }
+
+    // Seconds of history a tier can hold
+    static uint32_t retention(uint8_t tier) {
+        const TierSpec& spec = tierSpec(tier);
+        return (uint32_t)spec.blocks * RECORDS_PER_BLOCK * spec.resolution;
+    }
+
+    // Walks the records of one block in order
+    class BlockCursor {
+    public:
+        BlockCursor() : block(nullptr), resolution(1), index(0), offset(0), value(0), vessel(-1) {}
+
+        BlockCursor(const uint8_t* block, uint32_t resolution) : block(block), resolution(resolution), index(0) {
+            memcpy(&header, block, sizeof(header));
+            offset = sizeof(BlockHeader);
+            value = header.first;
+            vessel = header.vessel;
+        }
+
+        bool next(Record& out) {
+            if (!block || index >= header.count) return false;
+            if (index > 0) {
+                uint64_t word;
+                if (!readVarint(word)) return false;
+                if (word & 1) {
+                    uint64_t tag;
+                    if (!readVarint(tag)) return false;
+                    vessel = (int16_t)(tag - 1);
+                }
+                value += unzigzag(word >> 1);
+            }
+            out.time = header.startTime + index * resolution;
+            out.vessel = vessel;
+            out.weight = value / 10.0f;
+            index++;
+            return true;
+        }
+
+        size_t getOffset() const { return offset; }
+        int32_t getValue() const { return value; }
+        int16_t getVessel() const { return vessel; }
+
+    private:
+        bool readVarint(uint64_t& word) {
+            word = 0;
+            for (uint8_t shift = 0; shift < 64 && offset < BLOCK_SIZE; shift += 7) {
+                uint8_t byte = block[offset++];
+                word |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+        const uint8_t* block;
+        BlockHeader header;
+        uint32_t resolution;
+        uint16_t index;
+        size_t offset;
+        int32_t value;
+        int16_t vessel;
+    };
+
+    explicit HistoryStore(fs::FS& fs) : fs(fs), lastFlush(0) {
+        lock = xSemaphoreCreateMutex();
+        for (uint8_t i = 0; i < TIER_COUNT; i++) {
+            resetBlock(i, 0);
+            tiers[i].accCount = 0;
+        }
+    }
+
+    // Create the tier files on first use and resume the newest block of each tier
+    bool begin() {
+        bool ok = true;
+        for (uint8_t i = 0; i < TIER_COUNT; i++) {
+            if (!prepareFile(i)) {
+                Serial.printf("History: cannot prepare %s\n", tierSpec(i).path);
+                ok = false;
+                continue;
+            }
+            resume(i);
+        }
+        lastFlush = millis();
+        return ok;
+    }
+
+    // Feed one reading; time is Unix seconds
+    void record(uint32_t time, int16_t vessel, float weight) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        consolidate(0, time, vessel, weight);
+        xSemaphoreGive(lock);
+    }
+
+    // Write open blocks that changed since the last flush
+    void tick() {
+        if (millis() - lastFlush < FLUSH_INTERVAL_MS) return;
+        flush();
+    }
+
+    void flush() {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (uint8_t i = 0; i < TIER_COUNT; i++) {
+            if (tiers[i].dirty) writeBlock(i);
+        }
+        xSemaphoreGive(lock);
+        lastFlush = millis();
+    }
+
+    // Range of block sequence numbers currently held by a tier
+    void blockRange(uint8_t tier, uint32_t& oldest, uint32_t& newest) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        newest = tiers[tier].seq;
+        uint32_t blocks = tierSpec(tier).blocks;
+        oldest = newest >= blocks - 1 ? newest - (blocks - 1) : 0;
+        xSemaphoreGive(lock);
+    }
+
+    // Copy one block, from RAM if it is the open one. Safe to call from the web server task.
+    bool loadBlock(uint8_t tier, uint32_t seq, uint8_t* out) {
+        bool ok = false;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (seq == tiers[tier].seq) {
+            memcpy(out, tiers[tier].block, BLOCK_SIZE);
+            ok = true;
+        } else {
+            File file = fs.open(tierSpec(tier).path, "r");
+            if (file && file.seek(slotOffset(tier, seq))) {
+                ok = file.read(out, BLOCK_SIZE) == BLOCK_SIZE;
+            }
+            file.close();
+        }
+        xSemaphoreGive(lock);
+
+        if (!ok) return false;
+        BlockHeader header;
+        memcpy(&header, out, sizeof(header));
+        // A slot that was overwritten meanwhile, or never written, doesn't belong to this sequence
+        return header.magic == BLOCK_MAGIC && header.tier == tier && header.seq == seq && header.count > 0;
+    }
+
+private:
+    static constexpr uint8_t BLOCK_MAGIC = 0x49;
+    // Value varint (up to 10 bytes) plus a vessel varint (up to 3 bytes)
+    static constexpr size_t MAX_RECORD_BYTES = 13;
+
+    struct Tier {
+        uint8_t block[BLOCK_SIZE];
+        BlockHeader header;
+        uint32_t seq;        // Sequence number of the open block
+        size_t used;         // Bytes used in the open block
+        int32_t lastValue;
+        int16_t lastVessel;
+        bool dirty;
+
+        // Interval being consolidated
+        uint32_t accSlot;
+        int16_t accVessel;
+        float accSum;
+        uint16_t accCount;
+    };
+
+    static uint64_t zigzag(int64_t value) {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t value) {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    uint32_t slotOffset(uint8_t tier, uint32_t seq) const {
+        return (seq % tierSpec(tier).blocks) * BLOCK_SIZE;
+    }
+
+    // Average readings over the tier's interval; a finished interval is stored and passed on
+    void consolidate(uint8_t tier, uint32_t time, int16_t vessel, float weight) {
+        Tier& t = tiers[tier];
+        uint32_t slot = time / tierSpec(tier).resolution;
+        if (t.accCount > 0 && (slot != t.accSlot || vessel != t.accVessel)) {
+            uint32_t start = t.accSlot * tierSpec(tier).resolution;
+            float mean = t.accSum / t.accCount;
+            t.accCount = 0;
+            append(tier, start, t.accVessel, mean);
+            if (tier + 1 < TIER_COUNT) {
+                consolidate(tier + 1, start, t.accVessel, mean);
+            }
+        }
+        if (t.accCount == 0) {
+            t.accSlot = slot;
+            t.accVessel = vessel;
+            t.accSum = 0.0f;
+        }
+        t.accSum += weight;
+        t.accCount++;
+    }
+
+    void append(uint8_t tier, uint32_t time, int16_t vessel, float weight) {
+        Tier& t = tiers[tier];
+        int32_t value = (int32_t)lroundf(weight * 10.0f);
+
+        if (t.header.count > 0) {
+            uint32_t expected = t.header.startTime + t.header.count * tierSpec(tier).resolution;
+            if (t.header.count >= RECORDS_PER_BLOCK || time != expected || t.used + MAX_RECORD_BYTES > BLOCK_SIZE) {
+                writeBlock(tier);
+                resetBlock(tier, t.seq + 1);
+            }
+        }
+
+        if (t.header.count == 0) {
+            t.header.magic = BLOCK_MAGIC;
+            t.header.tier = tier;
+            t.header.seq = t.seq;
+            t.header.startTime = time;
+            t.header.first = value;
+            t.header.vessel = vessel;
+        } else {
+            bool vesselChanged = vessel != t.lastVessel;
+            writeVarint(t, (zigzag((int64_t)value - t.lastValue) << 1) | (vesselChanged ? 1 : 0));
+            if (vesselChanged) {
+                writeVarint(t, (uint16_t)(vessel + 1));
+            }
+        }
+        t.header.count++;
+        memcpy(t.block, &t.header, sizeof(t.header));
+        t.lastValue = value;
+        t.lastVessel = vessel;
+        t.dirty = true;
+    }
+
+    static void writeVarint(Tier& t, uint64_t word) {
+        do {
+            uint8_t byte = word & 0x7F;
+            word >>= 7;
+            t.block[t.used++] = word ? byte | 0x80 : byte;
+        } while (word);
+    }
+
+    void resetBlock(uint8_t tier, uint32_t seq) {
+        Tier& t = tiers[tier];
+        memset(t.block, 0, BLOCK_SIZE);
+        memset(&t.header, 0, sizeof(t.header));
+        t.seq = seq;
+        t.used = sizeof(BlockHeader);
+        t.lastValue = 0;
+        t.lastVessel = -1;
+        t.dirty = false;
+    }
+
+    void writeBlock(uint8_t tier) {
+        Tier& t = tiers[tier];
+        if (t.header.count == 0) return;
+        File file = fs.open(tierSpec(tier).path, "r+");
+        if (file && file.seek(slotOffset(tier, t.seq))) {
+            file.write(t.block, BLOCK_SIZE);
+        } else {
+            Serial.printf("History: write to %s failed\n", tierSpec(tier).path);
+        }
+        file.close();
+        t.dirty = false;
+    }
+
+    // Preallocate the ring so later writes never change the file size
+    bool prepareFile(uint8_t tier) {
+        const TierSpec& spec = tierSpec(tier);
+        size_t size = (size_t)spec.blocks * BLOCK_SIZE;
+        if (fs.exists(spec.path)) {
+            File file = fs.open(spec.path, "r");
+            bool sized = file && file.size() == size;
+            file.close();
+            if (sized) return true;
+        }
+
+        File file = fs.open(spec.path, "w");
+        if (!file) return false;
+        uint8_t zeros[64] = {};
+        for (size_t written = 0; written < size; written += sizeof(zeros)) {
+            if (file.write(zeros, sizeof(zeros)) != sizeof(zeros)) {
+                file.close();
+                return false;
+            }
+        }
+        file.close();
+        return true;
+    }
+
+    // Find the newest block by sequence number and reopen it for appending
+    void resume(uint8_t tier) {
+        const TierSpec& spec = tierSpec(tier);
+        File file = fs.open(spec.path, "r");
+        if (!file) return;
+
+        bool found = false;
+        uint32_t newest = 0;
+        uint16_t newestSlot = 0;
+        for (uint16_t slot = 0; slot < spec.blocks; slot++) {
+            BlockHeader header;
+            if (!file.seek(slot * BLOCK_SIZE) || file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) break;
+            if (header.magic != BLOCK_MAGIC || header.tier != tier || header.count == 0) continue;
+            if (!found || header.seq > newest) {
+                found = true;
+                newest = header.seq;
+                newestSlot = slot;
+            }
+        }
+
+        Tier& t = tiers[tier];
+        if (found && file.seek(newestSlot * BLOCK_SIZE) && file.read(t.block, BLOCK_SIZE) == BLOCK_SIZE) {
+            memcpy(&t.header, t.block, sizeof(t.header));
+            t.seq = newest;
+            BlockCursor cursor(t.block, spec.resolution);
+            Record record;
+            while (cursor.next(record)) {}
+            t.used = cursor.getOffset();
+            t.lastValue = cursor.getValue();
+            t.lastVessel = cursor.getVessel();
+            t.dirty = false;
+        }
+        file.close();
+    }
+
+    fs::FS& fs;
+    SemaphoreHandle_t lock;
+    Tier tiers[TIER_COUNT];
+    unsigned long lastFlush;
+};
+
+// Streams a time range of one tier as CSV, a block at a time, so a year of
+// history never has to fit in RAM. Used as the body source of a chunked
+// HTTP response; read() returns 0 once the range is exhausted.
+class HistoryReader {
+public:
+    HistoryReader(HistoryStore& store, uint8_t tier, uint32_t from, uint32_t to)
+        : store(store), tier(tier), from(from), to(to), done(false), lineLen(0), linePos(0) {
+        store.blockRange(tier, nextSeq, lastSeq);
+        lineLen = snprintf(line, sizeof(line), "time,vessel,weight\n");
+    }
+
+    size_t read(uint8_t* out, size_t maxLen) {
+        size_t written = 0;
+        while (written < maxLen) {
+            if (linePos < lineLen) {
+                size_t n = lineLen - linePos;
+                if (n > maxLen - written) n = maxLen - written;
+                memcpy(out + written, line + linePos, n);
+                linePos += n;
+                written += n;
+                continue;
+            }
+            if (!nextLine()) break;
+        }
+        return written;
+    }
+
+private:
+    bool nextLine() {
+        HistoryStore::Record record;
+        while (!done) {
+            if (!cursor.next(record)) {
+                if (!loadNextBlock()) {
+                    done = true;
+                    break;
+                }
+                continue;
+            }
+            if (record.time < from) continue;
+            if (record.time > to) {
+                done = true;
+                break;
+            }
+            lineLen = snprintf(line, sizeof(line), "%lu,%d,%.1f\n",
+                               (unsigned long)record.time, record.vessel, record.weight);
+            linePos = 0;
+            return true;
+        }
+        return false;
+    }
+
+    bool loadNextBlock() {
+        while ((int32_t)(lastSeq - nextSeq) >= 0) {
+            uint32_t seq = nextSeq++;
+            if (store.loadBlock(tier, seq, block)) {
+                cursor = HistoryStore::BlockCursor(block, HistoryStore::tierSpec(tier).resolution);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    HistoryStore& store;
+    uint8_t tier;
+    uint32_t from;
+    uint32_t to;
+    uint32_t nextSeq;
+    uint32_t lastSeq;
+    bool done;
+    uint8_t block[HistoryStore::BLOCK_SIZE];
+    HistoryStore::BlockCursor cursor;
+    char line[48];
+    size_t lineLen;
+    size_t linePos;
+};
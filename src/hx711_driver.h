@@ -0,0 +1,259 @@
+#pragma once
+#include <stdint.h>
+
+// Native HX711 driver for one or more chips on a shared clock line.
+//
+// All chips get the same SCK pulse train, so one readout clocks a word out
+// of every chip at once: each pulse samples all DOUT lines together, lane i
+// being chip i. The driver never waits on DOUT: the caller arms the ready
+// interrupt, gets woken on the falling edges that mark finished conversions
+// and only clocks the words out once every chip has one. Pin access goes
+// through an Io policy so the same code runs against GPIO on the device and
+// against sim/hx711_sim.h on the host.
+//
+// A chip that keeps DOUT high through FAULT_MISSES ready timeouts in a row,
+// dead or with a floating data line, is faulted: it is left out of the
+// ready check so the other chips keep sampling, and its words are not
+// valid. It comes back once it has shown a conversion at RECOVER_READS
+// readouts in a row.
+//
+// An Io policy provides:
+//   void begin();                                          configure pins
+//   uint8_t lanes();                                       number of chips, at most HX711_MAX_LANES
+//   uint32_t readDout();                                   current DOUT levels, bit i = lane i
+//   uint32_t clockBit();                                   one SCK pulse, returns DOUT levels sampled while SCK is high
+//   void attachReadyInterrupt(void (*isr)(void*), void* arg);   falling edge on any DOUT
+//   void detachReadyInterrupt();
+//   void disableReadyInterrupt();                          mask the attached interrupt, e.g. during readout
+//   void enableReadyInterrupt();
+static constexpr uint8_t HX711_MAX_LANES = 8;
+
+template <class Io>
+class Hx711Driver {
+public:
+    // Number of extra SCK pulses after the 24 data bits, selects the next conversion's input.
+    // The pulses are shared, so every chip on the clock line switches together.
+    enum Gain : uint8_t {
+        GAIN_A128 = 1,
+        GAIN_B32 = 2,
+        GAIN_A64 = 3
+    };
+
+    static constexpr uint8_t FAULT_MISSES = 3;
+    static constexpr uint8_t RECOVER_READS = 16;
+
+    explicit Hx711Driver(const Io& io, Gain gain = GAIN_A128) : io(io), gain(gain), faulted(0), streaks{} {}
+
+    void begin() {
+        io.begin();
+    }
+
+    // DOUT is held low while a finished conversion is waiting to be read; true once every
+    // working chip has one. With every chip faulted, any one showing a conversion will do.
+    bool isReady() {
+        uint32_t levels = io.readDout();
+        uint32_t active = allLanes() & ~faulted;
+        if (active == 0) return (levels & faulted) != faulted;
+        return (levels & active) == 0;
+    }
+
+    // Call when the wait for isReady() timed out. Returns the lanes that are faulted now.
+    uint32_t noteReadyTimeout() {
+        uint32_t busy = io.readDout() & allLanes() & ~faulted;
+        uint32_t newlyFaulted = 0;
+        for (uint8_t lane = 0; lane < io.lanes(); lane++) {
+            if ((busy >> lane) & 1u) {
+                if (++streaks[lane] >= FAULT_MISSES) newlyFaulted |= 1u << lane;
+            }
+        }
+        setFaulted(faulted | newlyFaulted);
+        return newlyFaulted;
+    }
+
+    // Lanes whose words from readWords() are not valid, bit i = lane i
+    uint32_t faultedLanes() const {
+        return faulted;
+    }
+
+    uint8_t lanes() {
+        return io.lanes();
+    }
+
+    // Clock out one conversion per chip into out[lanes()]. Only call once isReady() is true.
+    void readWords(int32_t* out) {
+        uint32_t values[HX711_MAX_LANES] = {};
+        uint8_t count = io.lanes();
+        trackFaults(io.readDout());
+        for (int i = 0; i < 24; i++) {
+            uint32_t levels = io.clockBit();
+            for (uint8_t lane = 0; lane < count; lane++) {
+                values[lane] = (values[lane] << 1) | ((levels >> lane) & 1u);
+            }
+        }
+        // Gain/channel pulses; these also release DOUT back to high
+        for (uint8_t i = 0; i < gain; i++) {
+            io.clockBit();
+        }
+
+        for (uint8_t lane = 0; lane < count; lane++) {
+            // Sign-extend the 24-bit two's complement value
+            if (values[lane] & 0x800000) {
+                values[lane] |= 0xFF000000;
+            }
+            out[lane] = (int32_t)values[lane];
+        }
+    }
+
+    void setGain(Gain newGain) {
+        gain = newGain;
+    }
+
+    Gain getGain() const {
+        return gain;
+    }
+
+    void attachReadyInterrupt(void (*isr)(void*), void* arg) {
+        io.attachReadyInterrupt(isr, arg);
+    }
+
+    void detachReadyInterrupt() {
+        io.detachReadyInterrupt();
+    }
+
+    // The data bits toggle DOUT during readWords(); mask the ready interrupt around it
+    // so they don't each raise an edge
+    void disableReadyInterrupt() {
+        io.disableReadyInterrupt();
+    }
+
+    void enableReadyInterrupt() {
+        io.enableReadyInterrupt();
+    }
+
+    Io& pins() {
+        return io;
+    }
+
+private:
+    uint32_t allLanes() {
+        return (1u << io.lanes()) - 1;
+    }
+
+    void setFaulted(uint32_t lanes) {
+        // Streaks count misses while a lane works and conversions while it is faulted
+        for (uint8_t lane = 0; lane < io.lanes(); lane++) {
+            if (((faulted ^ lanes) >> lane) & 1u) streaks[lane] = 0;
+        }
+        faulted = lanes;
+    }
+
+    // levels: DOUT before the readout. Working lanes start a new run of misses;
+    // a faulted lane with a conversion waiting counts towards its recovery.
+    void trackFaults(uint32_t levels) {
+        uint32_t recovered = 0;
+        for (uint8_t lane = 0; lane < io.lanes(); lane++) {
+            uint32_t bit = 1u << lane;
+            if (!(faulted & bit)) {
+                streaks[lane] = 0;
+            } else if (levels & bit) {
+                streaks[lane] = 0;
+            } else if (++streaks[lane] >= RECOVER_READS) {
+                recovered |= bit;
+            }
+        }
+        if (recovered) setFaulted(faulted & ~recovered);
+    }
+
+    Io io;
+    Gain gain;
+    uint32_t faulted;
+    uint8_t streaks[HX711_MAX_LANES];
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <soc/gpio_reg.h>
+
+// GPIO implementation of the Hx711Driver Io policy. Data pins must be below
+// GPIO 32 so one read of GPIO_IN_REG latches every DOUT line at once.
+class ArduinoHx711Io {
+public:
+    ArduinoHx711Io(const uint8_t* doutPins, uint8_t count, uint8_t sckPin) : count(count), sckPin(sckPin) {
+        for (uint8_t i = 0; i < count; i++) {
+            this->doutPins[i] = doutPins[i];
+        }
+        mux = portMUX_INITIALIZER_UNLOCKED;
+    }
+
+    void begin() {
+        pinMode(sckPin, OUTPUT);
+        digitalWrite(sckPin, LOW);
+        for (uint8_t i = 0; i < count; i++) {
+            pinMode(doutPins[i], INPUT);
+        }
+    }
+
+    uint8_t lanes() const {
+        return count;
+    }
+
+    uint32_t readDout() {
+        return toLanes(REG_READ(GPIO_IN_REG));
+    }
+
+    uint32_t clockBit() {
+        // SCK high for more than 60us powers the chips down, so only the high
+        // phase of each pulse is protected instead of the whole word. The
+        // rotary ISRs get to run between bits.
+        portENTER_CRITICAL(&mux);
+        digitalWrite(sckPin, HIGH);
+        delayMicroseconds(1);
+        uint32_t levels = REG_READ(GPIO_IN_REG);
+        digitalWrite(sckPin, LOW);
+        portEXIT_CRITICAL(&mux);
+        delayMicroseconds(1);
+        return toLanes(levels);
+    }
+
+    void attachReadyInterrupt(void (*isr)(void*), void* arg) {
+        for (uint8_t i = 0; i < count; i++) {
+            attachInterruptArg(digitalPinToInterrupt(doutPins[i]), isr, arg, FALLING);
+        }
+    }
+
+    void detachReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) {
+            detachInterrupt(digitalPinToInterrupt(doutPins[i]));
+        }
+    }
+
+    // Leaves the handlers installed, only masks the pins
+    void disableReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) {
+            gpio_intr_disable((gpio_num_t)doutPins[i]);
+        }
+    }
+
+    void enableReadyInterrupt() {
+        for (uint8_t i = 0; i < count; i++) {
+            gpio_intr_enable((gpio_num_t)doutPins[i]);
+        }
+    }
+
+private:
+    // GPIO input register bits to one bit per lane
+    uint32_t toLanes(uint32_t gpio) const {
+        uint32_t levels = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            levels |= ((gpio >> doutPins[i]) & 1u) << i;
+        }
+        return levels;
+    }
+
+    uint8_t doutPins[HX711_MAX_LANES];
+    uint8_t count;
+    uint8_t sckPin;
+    portMUX_TYPE mux;
+};
+#endif
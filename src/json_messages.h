@@ -0,0 +1,71 @@
+#pragma once
+#include <ArduinoJson.h>
+#include <math.h>
+#include "config.h"
+#include "telemetry.h"
+#include "vessel_manager.h"
+
+// JSON encoding of the per-tick WebSocket messages, kept apart from the
+// sending code so the host benchmarks time exactly what the firmware runs.
+
+// {"channel", "weight", "stable", "rate"?, "selectedVessel"?, "vesselWeight"?, "spoolWeight"?,
+//  "filamentWeight"?, "eta"?}; returns the length written to out
+inline size_t encodeJsonTelemetry(const TelemetrySnapshot& snapshot, const VesselConfig* vessel, char* out, size_t size) {
+    StaticJsonDocument<256> doc;
+    doc["channel"] = snapshot.channel;
+    doc["weight"] = snapshot.weight;
+    doc["stable"] = snapshot.stable;
+    if (!isnan(snapshot.rate)) doc["rate"] = snapshot.rate;
+    if (vessel) {
+        doc["selectedVessel"] = snapshot.selectedVessel;
+        doc["vesselWeight"] = vessel->vesselWeight;
+        doc["spoolWeight"] = vessel->spoolWeight;
+        doc["filamentWeight"] = snapshot.filamentWeight;
+        if (!isnan(snapshot.eta)) doc["eta"] = (uint32_t)snapshot.eta;
+    }
+    return serializeJson(doc, out, size);
+}
+
+// The name is copied into the document; vessel is usually a temporary copy
+inline void fillVessel(JsonObject v, const VesselConfig* vessel) {
+    v["id"] = vessel->id;
+    v["name"] = (char*)vessel->name;
+    v["vesselWeight"] = vessel->vesselWeight;
+    v["spoolWeight"] = vessel->spoolWeight;
+}
+
+// One page of the vessel list in name order. The cursor is the (name, id) of
+// the last vessel sent, so paging stays consistent while vessels change.
+// Deltas after version bring the page up to date; the caller reads it before
+// the vessels are listed so a change made meanwhile is still sent as a delta.
+// selectedVessel is channel 0's; with several load cells selectedVessels
+// lists the vessel bound to every channel.
+inline void fillVesselPage(JsonObject doc, VesselManager& manager, uint32_t version,
+                           const char* afterName, int afterId, int limit, bool first) {
+    JsonArray vessels = doc.createNestedArray("vessels");
+
+    // Copied in one go so the page is consistent even while another task edits the table
+    VesselConfig page[VESSEL_PAGE_SIZE];
+    if (limit > VESSEL_PAGE_SIZE) limit = VESSEL_PAGE_SIZE;
+    bool more;
+    int count = manager.getVesselsAfter(afterName, afterId, page, limit, more);
+    for (int i = 0; i < count; i++) {
+        fillVessel(vessels.createNestedObject(), &page[i]);
+    }
+
+    doc["first"] = first;
+    doc["version"] = version;
+    doc["total"] = manager.getVesselCount();
+    if (count > 0 && more) {
+        JsonObject cursor = doc.createNestedObject("cursor");
+        cursor["name"] = (char*)page[count - 1].name;
+        cursor["id"] = page[count - 1].id;
+    }
+    doc["selectedVessel"] = manager.getSelectedVessel();
+    if (SCALE_CHANNELS > 1) {
+        JsonArray selected = doc.createNestedArray("selectedVessels");
+        for (uint8_t channel = 0; channel < SCALE_CHANNELS; channel++) {
+            selected.add(manager.getSelectedVessel(channel));
+        }
+    }
+}
@@ -9,17 +9,52 @@
 #include "vessel_manager.h"
 #include "display_ui.h"
 #include "scale.h"
+#include "calibration.h"
+#include "telemetry.h"
+#include "frame_pool.h"
+#include "history_store.h"
+#include "json_messages.h"
+#include "web_assets.h"
+#include "metrics.h"
+#include "profiler.h"
+#include <StreamString.h>
+#include <time.h>
+#include <sys/time.h>
+#include <memory>
+#include <atomic>
 #include <AsyncWebSocket.h>
 #include "wifi_credentials.h"
 
 void setupWebServer();
+void sendCalibrationPoints(uint8_t channel);
+void sendChannelTelemetry(uint8_t channel);
+void sendTelemetry(const TelemetrySnapshot& snapshot, const VesselConfig* vessel);
+void pumpSampleStream();
+void broadcastVesselChanges();
+void handleSerialCommands();
+void pumpCapture();
 
 Scale* scale;
 VesselManager* vesselManager;
 DisplayUI *display;
+HistoryStore* history;
+WebAssets webAssets(SPIFFS);
+fs::SPIFFSFS userData;  // "userdata" partition: vessels and history
+Metrics metrics;
+#if PROFILER_ENABLED
+Profiler profiler;
+#endif
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 Preferences preferences;
+Calibration calibration;
+
+// Telemetry frames are encoded once per channel and shared by every subscribed client
+#define TELEMETRY_POOL_SIZE (2 + 2 * SCALE_CHANNELS)
+#define TELEMETRY_JSON_MAX  256
+FramePool<TELEMETRY_POOL_SIZE> jsonFrames;
+FramePool<TELEMETRY_POOL_SIZE> binaryFrames;
+FramePool<TELEMETRY_POOL_SIZE> streamFrames;
 
 volatile bool rotaryInterrupt = false;
 volatile int rotaryDirection = 0;
@@ -31,6 +66,18 @@ volatile unsigned long lastButtonPressTime = 0;
 bool calibrationMode = false;
 float knownWeight = 100.0;
 
+// Tare requests from the web UI are applied by loop() once the reading settles;
+// one bit per channel
+std::atomic<uint32_t> tareRequests(0);
+unsigned long tareRequestTime[SCALE_CHANNELS];
+
+// Vessel picked in the web UI for each channel, applied by loop() because the
+// display's menu state belongs to it; 0 = none, a newer pick replaces an older one
+std::atomic<uint16_t> vesselSelectRequests[SCALE_CHANNELS];
+
+// Last vessel version broadcast as a delta; clients are in sync once they have applied it
+volatile uint32_t vesselBroadcastVersion = 0;
+
 void IRAM_ATTR rotaryISR_cw() {
     unsigned long currentTime = millis();
     if(!digitalRead(ROTARY_PIN_RIGHT) && (currentTime - lastButtonPressTime > BUTTON_DEBOUNCE_DELAY)) {
@@ -57,15 +104,82 @@ void IRAM_ATTR buttonISR() {
     lastButtonPressTime = currentTime;
 }
 
+// What a client last received about one channel
+struct TelemetrySent {
+    unsigned long lastSent;
+    float lastWeight;
+    bool lastStable;
+    int16_t lastVessel;
+    bool hasSent;
+};
+
 struct WSClient {
     uint32_t id;
     bool updatesEnabled;
+    bool binaryTelemetry;  // Compact frames from telemetry.h instead of JSON
     bool inUse;
+
+    // Subscription settings
+    uint16_t intervalMs;   // Minimum time between frames
+    float deadband;        // Only send once the weight moved this many grams (0 = always)
+    bool stableOnly;       // Only send settled readings
+    uint32_t channelMask;  // Channels the client gets frames for, one bit each
+
+    TelemetrySent sent[SCALE_CHANNELS];
+    uint32_t sentFrames;
+    uint32_t droppedFrames;  // Frames skipped because the client's queue was backed up
+
+    bool streaming;          // Receives every raw sample in batched frames
+    uint16_t streamBatch;    // Samples per frame
+    uint32_t streamCursor;   // Sequence number of the last sample streamed to it
+    unsigned long lastStreamSend;
+    uint32_t streamSamplesSent;  // In the current stats window
+    uint32_t streamSamplesLost;  // Overwritten in the ring before they could be streamed
+    uint32_t sentBatches;
+    uint32_t droppedBatches; // Sample batches skipped because the client's queue was backed up
 };
 
+// Telemetry is evaluated every TELEMETRY_TICK_MS; each client gets frames at its own rate
+#define TELEMETRY_TICK_MS        50
+#define TELEMETRY_DEFAULT_MS     200
+#define TELEMETRY_MAX_INTERVAL   60000
+#define TELEMETRY_KEEPALIVE_MS   5000
+// A client with this many messages still queued is skipped until it catches up;
+// every channel may add a frame per tick
+#define TELEMETRY_MAX_QUEUED     (1 + SCALE_CHANNELS)
+#define ALL_CHANNELS             ((uint32_t)((1ull << SCALE_CHANNELS) - 1))
+
+// Raw sample streaming: batches go out once full or after STREAM_MAX_LATENCY_MS
+#define STREAM_DEFAULT_BATCH     16
+#define STREAM_MAX_LATENCY_MS    250
+#define STREAM_MAX_QUEUED        4
+#define STREAM_STATS_MS          1000
+
+// Sample stream state shared by all streaming clients; cursors and batch sizes are per client
+uint8_t streamChannel = 0;          // Load cell whose samples are streamed
+unsigned long streamStatsStart = 0;
+uint32_t streamStatsSeq = 0;        // Ring head at the start of the stats window
+
+// Sample trace on the serial console, toggled with "capture"
+bool traceCapture = false;
+uint8_t captureChannel = 0;
+uint32_t captureCursor = 0;         // Sequence number of the last sample printed
+
 #define MAX_CLIENTS 10
 WSClient wsClients[MAX_CLIENTS];
 int numClients = 0;
+// The AsyncTCP task adds, removes and reconfigures clients while loop() sends to
+// them, and removing one moves the others down. Anything that walks or changes
+// wsClients holds this lock; indices, and the stream group masks built from
+// them, are only valid while it is held.
+SemaphoreHandle_t clientsLock;
+
+// Holds clientsLock for a scope
+class ClientsGuard {
+public:
+    ClientsGuard() { xSemaphoreTake(clientsLock, portMAX_DELAY); }
+    ~ClientsGuard() { xSemaphoreGive(clientsLock); }
+};
 
 WSClient* findClient(uint32_t id) {
     for (int i = 0; i < numClients; i++) {
@@ -80,7 +194,26 @@ WSClient* addClient(uint32_t id) {
     if (numClients < MAX_CLIENTS) {
         wsClients[numClients].id = id;
         wsClients[numClients].updatesEnabled = false;
+        wsClients[numClients].binaryTelemetry = false;
         wsClients[numClients].inUse = true;
+        wsClients[numClients].intervalMs = TELEMETRY_DEFAULT_MS;
+        wsClients[numClients].deadband = 0.0f;
+        wsClients[numClients].stableOnly = false;
+        wsClients[numClients].channelMask = ALL_CHANNELS;
+        for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+            wsClients[numClients].sent[c].lastSent = 0;
+            wsClients[numClients].sent[c].hasSent = false;
+        }
+        wsClients[numClients].sentFrames = 0;
+        wsClients[numClients].droppedFrames = 0;
+        wsClients[numClients].streaming = false;
+        wsClients[numClients].streamBatch = STREAM_DEFAULT_BATCH;
+        wsClients[numClients].streamCursor = 0;
+        wsClients[numClients].lastStreamSend = 0;
+        wsClients[numClients].streamSamplesSent = 0;
+        wsClients[numClients].streamSamplesLost = 0;
+        wsClients[numClients].sentBatches = 0;
+        wsClients[numClients].droppedBatches = 0;
         return &wsClients[numClients++];
     }
     return nullptr;
@@ -103,7 +236,7 @@ void removeClient(uint32_t id) {
     }
 }
 
-void broadcastStatus(const char* status, bool error = false) {
+String encodeStatus(const char* status, bool error) {
     StaticJsonDocument<200> doc;
     doc["status"] = status;
     if (error) {
@@ -111,88 +244,175 @@ void broadcastStatus(const char* status, bool error = false) {
     }
     String response;
     serializeJson(doc, response);
-    ws.textAll(response);
+    return response;
 }
 
-bool calibrateScale(float knownWeight) {
-    if (knownWeight <= 0) {
-        return false;
-    }
-
-    // Give time for stability after weight is placed
-    delay(1000);
+void broadcastStatus(const char* status, bool error = false) {
+    ws.textAll(encodeStatus(status, error));
+}
 
-    // Take multiple raw readings with longer delays for stability
-    float readings[5];
-    for (int i = 0; i 
-        < 5; i++) {
-        readings[i] = scale->getRawValue();
-        delay(500);  // Increased delay between readings
-    }
+// Status for one client only, e.g. the answer to something it asked for
+void sendStatus(AsyncWebSocketClient* client, const char* status, bool error = false) {
+    client->text(encodeStatus(status, error));
+}
 
-    // Check readings stability
-    float avgReading = 0;
-    float maxDiff = 0;
-    for (int i = 0; i < 5; i++) {
-        avgReading += readings[i];
-        for (int j = i + 1; j < 5; j++) {
-            float diff = abs(readings[i] - readings[j]);
-            if (diff > maxDiff) maxDiff = diff;
-        }
+// Status about one load cell; names it when the board has several
+void broadcastChannelStatus(uint8_t channel, const char* status, bool error = false) {
+    if (SCALE_CHANNELS == 1) {
+        broadcastStatus(status, error);
+        return;
     }
-    avgReading /= 5;
+    char message[192];
+    snprintf(message, sizeof(message), "Channel %u: %s", channel + 1, status);
+    broadcastStatus(message, error);
+}
 
-    // If readings are unstable (variation percentage > margin), return false
-    float variationPercent = (maxDiff / avgReading);
-    Serial.printf("Calibration stability: variation %.3f%%, margin %.3f%%, readings: %.2f %.2f %.2f %.2f %.2f\n",
-                 variationPercent * 100, scale->getCalibrationMargin() * 100,
-                 readings[0], readings[1], readings[2], readings[3], readings[4]);
-    if (variationPercent > scale->getCalibrationMargin()) {
-        return false;
-    }
+// Every channel has its own calibration namespace. Channel 0 keeps the one
+// of single load cell builds so an existing calibration carries over.
+void beginCalibrationPreferences(uint8_t channel, bool readOnly) {
+    char name[8] = "scale";
+    if (channel > 0) snprintf(name, sizeof(name), "scale%u", channel);
+    preferences.begin(name, readOnly);
+}
 
-    // Calculate and set scale factor
-    // Scale factor = raw reading / known weight (to convert raw readings to weight)
-    // Note: getRawValue() already subtracts the offset
-    float scaleFactor = avgReading / knownWeight;
-    Serial.printf("Calibration data:\n");
-    Serial.printf("  Raw reading (with offset): %.2f\n", avgReading);
-    Serial.printf("  Known weight: %.2f\n", knownWeight);
-    Serial.printf("  Scale factor: %.2f\n", scaleFactor);
-    Serial.printf("  Current offset: %.2f\n", scale->getOffset());
-    if (scaleFactor <= 0) {
-        Serial.printf("Invalid scale factor!\n");
-        return false;
-    }
+// Filter settings are shared by all channels and stay in the "scale" namespace
+FilterConfig loadFilterConfig() {
+    FilterConfig config = defaultFilterConfig();
+    preferences.begin("scale", true);
+    config.outlierEnabled = preferences.getBool("outEn", config.outlierEnabled);
+    config.outlierSigma = preferences.getFloat("outSigma", config.outlierSigma);
+    config.medianEnabled = preferences.getBool("medEn", config.medianEnabled);
+    config.medianWindow = preferences.getUChar("medWin", config.medianWindow);
+    config.emaEnabled = preferences.getBool("emaEn", config.emaEnabled);
+    config.emaAlpha = preferences.getFloat("emaAlpha", config.emaAlpha);
+    preferences.end();
+    return config;
+}
 
-    // Set and save the new scale factor and calibration margin
-    scale->setCalibrationFactor(scaleFactor);
+void saveFilterConfig(const FilterConfig& config) {
     preferences.begin("scale", false);
-    preferences.putFloat("factor", scaleFactor);
-    preferences.putFloat("margin", scale->getCalibrationMargin());
+    preferences.putBool("outEn", config.outlierEnabled);
+    preferences.putFloat("outSigma", config.outlierSigma);
+    preferences.putBool("medEn", config.medianEnabled);
+    preferences.putUChar("medWin", config.medianWindow);
+    preferences.putBool("emaEn", config.emaEnabled);
+    preferences.putFloat("emaAlpha", config.emaAlpha);
     preferences.end();
+}
 
-    Serial.printf("Calibrated scale - Raw reading: %.2f, Weight: %.2f, Factor: %.2f\n",
-                 avgReading, knownWeight, scaleFactor);
+void sendCalibrationProgress() {
+    AsyncWebSocketClient* client = ws.client(calibration.getClientId());
+    if (!client) return;
 
-    return true;
+    StaticJsonDocument<200> doc;
+    JsonObject progress = doc.createNestedObject("calibration");
+    progress["state"] = calibration.getStateName();
+    progress["progress"] = calibration.getProgress();
+    progress["samples"] = calibration.getSampleCount();
+    progress["spread"] = calibration.getSpread();
+    String json;
+    serializeJson(doc, json);
+    client->text(json);
+}
+
+void saveCalibrationTable(uint8_t channel) {
+    CalibrationTable table = scale->channel(channel).getCalibrationTable();
+    beginCalibrationPreferences(channel, false);
+    if (table.isEmpty()) {
+        preferences.remove("points");
+    } else {
+        preferences.putBytes("points", table.data(), table.size() * sizeof(CalibrationTable::Point));
+    }
+    preferences.end();
+}
+
+void loadCalibrationTable(uint8_t channel) {
+    CalibrationTable::Point points[CalibrationTable::MAX_POINTS];
+    beginCalibrationPreferences(channel, true);
+    size_t len = preferences.getBytesLength("points");
+    if (len > 0 && len <= sizeof(points) && len % sizeof(CalibrationTable::Point) == 0) {
+        preferences.getBytes("points", points, len);
+        if (!scale->channel(channel).loadCalibrationTable(points, len / sizeof(CalibrationTable::Point))) {
+            Serial.printf("Stored calibration points of channel %u are invalid, ignoring them\n", channel);
+        }
+    }
+    preferences.end();
+}
+
+void finishCalibration() {
+    uint8_t channel = calibration.getChannel();
+    ScaleChannel& cell = scale->channel(channel);
+    Serial.printf("Calibration of channel %u %s after %lums: %u readings, spread %.3f%%, margin %.3f%%\n",
+                 channel, calibration.getStateName(), calibration.getElapsed(), calibration.getSampleCount(),
+                 calibration.getSpread() * 100, cell.getCalibrationMargin() * 100);
+
+    if (calibration.getMode() == Calibration::POINT) {
+        if (calibration.getState() == Calibration::SUCCEEDED &&
+            cell.addCalibrationPoint(calibration.getMeanReading(), calibration.getKnownWeight())) {
+            Serial.printf("Calibration point: %.2f counts = %.2fg\n",
+                         calibration.getMeanReading(), calibration.getKnownWeight());
+            saveCalibrationTable(channel);
+            broadcastChannelStatus(channel, "Calibration point added");
+            sendCalibrationPoints(channel);
+        } else {
+            broadcastChannelStatus(channel, "Failed to add calibration point - unstable readings, table full, or inconsistent with existing points", true);
+        }
+    } else if (calibration.getState() == Calibration::SUCCEEDED) {
+        // Scale factor = raw reading / known weight (to convert raw readings to weight)
+        // Note: readings already have the offset subtracted
+        float scaleFactor = calibration.getFactor();
+        Serial.printf("Calibration data:\n");
+        Serial.printf("  Raw reading (with offset): %.2f\n", calibration.getMeanReading());
+        Serial.printf("  Known weight: %.2f\n", calibration.getKnownWeight());
+        Serial.printf("  Scale factor: %.2f\n", scaleFactor);
+        Serial.printf("  Current offset: %.2f\n", cell.getOffset());
+
+        // Set and save the new scale factor and calibration margin.
+        // A single-point calibration replaces any multi-point table.
+        cell.setCalibrationFactor(scaleFactor);
+        cell.clearCalibrationPoints();
+        saveCalibrationTable(channel);
+        beginCalibrationPreferences(channel, false);
+        preferences.putFloat("factor", scaleFactor);
+        preferences.putFloat("margin", cell.getCalibrationMargin());
+        preferences.end();
+
+        broadcastChannelStatus(channel, "Scale calibrated successfully. Remove calibration weight and tare again if needed.");
+    } else {
+        broadcastChannelStatus(channel, "Calibration failed - unstable readings. Make sure to tare with nothing on the scale BEFORE placing the calibration weight.", true);
+    }
+    calibration.finish();
 }
 
 void setup() {
     Serial.begin(115200);
+#if PROFILER_ENABLED
+    profiler.begin();
+#endif
     Wire.begin(I2C_SDA, I2C_SCL);
+    clientsLock = xSemaphoreCreateMutex();
 
+    // The web UI partition is only needed when the pages are served from it
+#ifndef WEB_ASSETS_IN_FLASH
     if(!SPIFFS.begin(true)) {
         Serial.println("SPIFFS Mount Failed");
         return;
     }
+#endif
+    // Vessels and history have a partition of their own that "pio run -t uploadfs" leaves alone
+    if (!userData.begin(true, "/userdata", 5, "userdata")) {
+        Serial.println("User data mount failed, vessels and history will not be saved");
+    }
+
+    history = new HistoryStore(userData);
+    history->begin();
 
     // Initialize scale first
     scale = new Scale();
     scale->init();
 
     // Initialize vessel manager
-    vesselManager = new VesselManager();
+    vesselManager = new VesselManager(userData);
 
     // Initialize display
     display = new DisplayUI();
@@ -237,6 +457,8 @@ void setup() {
         Serial.print("IP address: ");
         Serial.println(WiFi.localIP());
         display->setWiFiStatus("Connected", WiFi.localIP().toString().c_str());
+        // Wall-clock time for the history store
+        configTime(0, 0, NTP_SERVER);
         display->showWeight(0.0, nullptr);
         delay(2000);
         display->clearWiFiStatus();
@@ -255,17 +477,23 @@ void setup() {
     display->setWiFiStatus("AP Mode", WiFi.softAPIP().toString().c_str());
 #endif
 
-    // Load scale calibration
-    preferences.begin("scale", false);
-    float scaleFactor = preferences.getFloat("factor", 1.0f);
-    float offset = preferences.getFloat("offset", 0.0f);
-    float margin = preferences.getFloat("margin", 0.02f);
-    preferences.end();
-
-    scale->setCalibrationFactor(scaleFactor);
-    scale->setOffset(offset);
-    scale->setCalibrationMargin(margin);
-    scale->tare();
+    // Load every channel's calibration
+    FilterConfig filterConfig = loadFilterConfig();
+    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+        ScaleChannel& cell = scale->channel(c);
+        beginCalibrationPreferences(c, false);
+        cell.setCalibrationFactor(preferences.getFloat("factor", 1.0f));
+        cell.setOffset(preferences.getFloat("offset", 0.0f));
+        cell.setCalibrationMargin(preferences.getFloat("margin", 0.02f));
+        preferences.end();
+        cell.setFilterConfig(filterConfig);
+        loadCalibrationTable(c);
+    }
+    // loop() tares every channel once its reading settles, like a tare from the web UI
+    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+        tareRequestTime[c] = millis();
+    }
+    tareRequests.store(ALL_CHANNELS);
 
     pinMode(ROTARY_PIN_LEFT, INPUT_PULLUP);
     pinMode(ROTARY_PIN_RIGHT, INPUT_PULLUP);
@@ -279,10 +507,15 @@ void setup() {
 }
 
 void loop() {
+    uint32_t loopStart = micros();
+    PROFILE_LOOP_BEGIN();
     static unsigned long lastUpdate = 0;
-    static VesselConfig* currentVessel = nullptr;
+
+    handleSerialCommands();
+    pumpCapture();
 
     if (rotaryInterrupt) {
+        PROFILE_SECTION(PROFILE_LOOP_INPUT);
         if(rotaryDirection > 0) {
             Serial.print("CW ");
         } else {
@@ -294,66 +527,444 @@ void loop() {
     }
 
     if (buttonPressed) {
+        PROFILE_SECTION(PROFILE_LOOP_INPUT);
         Serial.println("Button");
         display->handleButton();
-        if (display->getMenuState() == MAIN_SCREEN) {
-            currentVessel = vesselManager->getVessel(display->getSelectedVessel());
-        }
         buttonPressed = false;
     }
+    display->pumpQuickAdd();
+
+    // Calibration runs here rather than in the WebSocket callback so the network stays responsive
+    calibration.startPending();
+    if (calibration.isActive()) {
+        PROFILE_SECTION(PROFILE_LOOP_CALIBRATION);
+        if (calibration.update(scale->channel(calibration.getChannel()))) {
+            sendCalibrationProgress();
+            if (!calibration.isActive()) {
+                finishCalibration();
+            }
+        }
+    }
 
-    if (millis() - lastUpdate > 200) {
-        // Always ensure we have the current vessel
-        if (display->getMenuState() == MAIN_SCREEN) {
-            currentVessel = vesselManager->getVessel(display->getSelectedVessel());
+    // Report load cells whose chip stopped delivering conversions, and ones that came back
+    static uint32_t reportedFaults = 0;
+    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+        bool faulted = scale->isFaulted(c);
+        if (faulted == (bool)(reportedFaults & (1u << c))) continue;
+        reportedFaults ^= 1u << c;
+        Serial.printf("Load cell channel %u %s\n", c, faulted ? "faulted" : "recovered");
+        broadcastChannelStatus(c, faulted ? "Load cell not responding - check the HX711 wiring" : "Load cell responding again",
+                               faulted);
+    }
+
+    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+        uint16_t id = vesselSelectRequests[c].exchange(0);
+        if (id != 0) display->setSelectedVessel(id, c);
+    }
+
+    uint32_t pendingTares = tareRequests.load();
+    for (uint8_t c = 0; pendingTares != 0 && c < SCALE_CHANNELS; c++) {
+        ScaleChannel& cell = scale->channel(c);
+        if (!(pendingTares & (1u << c))) continue;
+        if (!cell.isStable() && millis() - tareRequestTime[c] <= Scale::STABILITY_TIMEOUT) continue;
+        PROFILE_SECTION(PROFILE_LOOP_CALIBRATION);
+        tareRequests.fetch_and(~(1u << c));
+        bool settled = cell.isStable();
+        if (cell.tare()) {
+            broadcastChannelStatus(c, settled ? "Scale tared" : "Scale tared (reading did not settle)");
+        } else {
+            broadcastChannelStatus(c, "Tare failed - no readings from load cell", true);
         }
+    }
 
-        float weight = scale->getWeight();
-        display->showWeight(weight, currentVessel);
+    if (millis() - lastUpdate > 200) {
+        PROFILE_SECTION(PROFILE_LOOP_WEIGHT);
+        // Left alone, the main screen works through the channels
+        if (SCALE_CHANNELS > 1 && DISPLAY_CHANNEL_CYCLE_MS > 0 && display->getMenuState() == MAIN_SCREEN &&
+            millis() - display->getChannelShownAt() >= DISPLAY_CHANNEL_CYCLE_MS) {
+            display->showChannel((display->getChannel() + 1) % SCALE_CHANNELS);
+        }
+        // Copied every time; the web UI can edit or delete the vessel at any moment
+        uint8_t channel = display->getChannel();
+        VesselConfig currentVessel;
+        bool hasVessel = vesselManager->getSelectedVessel(channel, currentVessel);
+        display->showWeight(scale->channel(channel).getWeight(), hasVessel ? &currentVessel : nullptr);
+
+        // History is only kept once the clock has been set, via NTP or a web client.
+        // It holds a single series, which follows channel 0.
+        time_t now = time(nullptr);
+        if (now >= HistoryStore::MIN_VALID_TIME) {
+            VesselConfig historyVessel;
+            float weight = scale->channel(0).getWeight();
+            if (vesselManager->getSelectedVessel(0, historyVessel)) {
+                history->record(now, historyVessel.id,
+                                weight - historyVessel.vesselWeight - historyVessel.spoolWeight);
+            } else {
+                history->record(now, -1, weight);
+            }
+        }
         lastUpdate = millis();
     }
+    {
+        PROFILE_SECTION(PROFILE_LOOP_HISTORY);
+        history->tick();
+    }
 
-    static unsigned long lastWebSocketUpdate = 0;
-    if (millis() - lastWebSocketUpdate > 200) {
+    pumpSampleStream();
+    broadcastVesselChanges();
+
+    static unsigned long lastTelemetry = 0;
+    if (millis() - lastTelemetry >= TELEMETRY_TICK_MS) {
+        PROFILE_SECTION(PROFILE_LOOP_TELEMETRY);
         if (ws.count() > 0) {
-            float weight = scale->getWeight();
-            VesselConfig* currentVessel = nullptr;
-            int selectedIndex = -1;
+            // Start from a different channel every tick so a client that can
+            // only take some of the frames isn't always short of the same ones
+            static uint8_t firstChannel = 0;
+            for (uint8_t i = 0; i < SCALE_CHANNELS; i++) {
+                sendChannelTelemetry((firstChannel + i) % SCALE_CHANNELS);
+            }
+            firstChannel = (firstChannel + 1) % SCALE_CHANNELS;
+        }
+        lastTelemetry = millis();
+    }
 
-            if (display->getMenuState() == MAIN_SCREEN) {
-                selectedIndex = display->getSelectedVessel();
-                currentVessel = vesselManager->getVessel(selectedIndex);
+    metrics.loopTime.observe(micros() - loopStart);
+    PROFILE_LOOP_END();
+}
+
+void sendChannelTelemetry(uint8_t channel) {
+    ScaleChannel& cell = scale->channel(channel);
+    // One non-blocking read of the latest sample feeds every client
+    Sample sample = {};
+    float weight = cell.getSamples().latest(sample) ? cell.toWeight(sample.filtered) : 0.0f;
+
+    TelemetrySnapshot snapshot = {};
+    snapshot.seq = sample.seq;
+    snapshot.timestamp = sample.timestamp;
+    snapshot.raw = sample.raw;
+    snapshot.weight = weight;
+    snapshot.stable = cell.isStable();
+    snapshot.rate = cell.getConsumptionRate();
+    snapshot.eta = NAN;
+    snapshot.selectedVessel = -1;
+    snapshot.channel = channel;
+
+    VesselConfig selected;
+    const VesselConfig* vessel = nullptr;
+    if (display->getMenuState() == MAIN_SCREEN && vesselManager->getSelectedVessel(channel, selected)) {
+        vessel = &selected;
+    }
+    if (vessel) {
+        snapshot.hasVessel = true;
+        snapshot.selectedVessel = vessel->id;
+        snapshot.filamentWeight = weight - vessel->vesselWeight - vessel->spoolWeight;
+        snapshot.eta = secondsToEmpty(snapshot.filamentWeight, snapshot.rate);
+    }
+    sendTelemetry(snapshot, vessel);
+}
+
+// Header of a sample trace for the host replay tool: the conversion and
+// filter settings as "# key=value" lines, then the column names
+void writeTraceHeader(Print& out, uint8_t channel) {
+    ScaleChannel& cell = scale->channel(channel);
+    out.println("# filament_scale trace");
+    out.printf("# channel=%u\n", channel);
+    out.printf("# factor=%.6f\n", cell.getCalibrationFactor());
+    out.printf("# offset=%.1f\n", cell.getOffset());
+    CalibrationTable table = cell.getCalibrationTable();
+    for (uint8_t i = 0; i < table.size(); i++) {
+        out.printf("# point=%.1f,%.3f\n", table.getPoint(i).counts, table.getPoint(i).grams);
+    }
+    FilterConfig config = cell.getFilterConfig();
+    if (config.outlierEnabled) out.printf("# outlier=%.2f\n", config.outlierSigma);
+    if (config.medianEnabled) out.printf("# median=%u\n", config.medianWindow);
+    if (config.emaEnabled) out.printf("# ema=%.3f\n", config.emaAlpha);
+    out.println("timestamp_ms,raw");
+}
+
+// While capturing, every new sample goes to the serial console as "timestamp,raw"
+void pumpCapture() {
+    if (!traceCapture) return;
+    const SampleRing<ScaleChannel::SAMPLE_BUFFER_SIZE>& ring = scale->channel(captureChannel).getSamples();
+    uint32_t head = ring.headSeq();
+    uint32_t lost = 0;
+    for (; captureCursor != head; captureCursor++) {
+        Sample sample;
+        if (ring.read(captureCursor + 1, sample)) {
+            Serial.printf("%lu,%ld\n", (unsigned long)sample.timestamp, (long)sample.raw);
+        } else {
+            lost++;
+        }
+    }
+    if (lost > 0) Serial.printf("# lost %u samples\n", (unsigned)lost);
+}
+
+// Serial console: "profile" prints the section timings, "capture [channel]"
+// starts or stops the sample trace
+void handleSerialCommands() {
+    static char line[32];
+    static uint8_t length = 0;
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c != '\r' && c != '\n') {
+            if (length < sizeof(line) - 1) line[length++] = c;
+            continue;
+        }
+        line[length] = '\0';
+        if (strcmp(line, "profile") == 0) {
+#if PROFILER_ENABLED
+            profiler.dump(Serial);
+#else
+            Serial.println("Profiler not enabled, build with -DPROFILER_ENABLED=1");
+#endif
+        } else if (strncmp(line, "capture", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+            int channel = line[7] == ' ' ? atoi(line + 8) : 0;
+            if (traceCapture) {
+                traceCapture = false;
+                Serial.println("# end of trace");
+            } else if (channel >= 0 && channel < SCALE_CHANNELS) {
+                traceCapture = true;
+                captureChannel = channel;
+                captureCursor = scale->channel(captureChannel).getSamples().headSeq();
+                writeTraceHeader(Serial, captureChannel);
+            } else {
+                Serial.printf("No channel %d\n", channel);
             }
+        } else if (length > 0) {
+            Serial.printf("Unknown command: %s\n", line);
+        }
+        length = 0;
+    }
+}
 
-            StaticJsonDocument<200> doc;
-            doc["weight"] = weight;
-            if (currentVessel) {
-                doc["selectedVessel"] = selectedIndex;
-                doc["vesselWeight"] = currentVessel->vesselWeight;
-                doc["spoolWeight"] = currentVessel->spoolWeight;
-                doc["filamentWeight"] = weight - currentVessel->vesselWeight - currentVessel->spoolWeight;
+// Decide whether a subscribed client gets this snapshot: honours its rate,
+// deadband and stable-only settings, and skips clients whose send queue is
+// backed up. Skipped frames coalesce: the next one sent is always the latest.
+// Every channel is paced on its own.
+bool telemetryDue(WSClient& wsClient, AsyncWebSocketClient* client, const TelemetrySnapshot& snapshot, unsigned long now) {
+    if (!(wsClient.channelMask & (1u << snapshot.channel))) return false;
+    const TelemetrySent& sent = wsClient.sent[snapshot.channel];
+    if (now - sent.lastSent < wsClient.intervalMs) return false;
+    if (wsClient.stableOnly && !snapshot.stable) return false;
+
+    bool changed = !sent.hasSent ||
+        fabsf(snapshot.weight - sent.lastWeight) >= wsClient.deadband ||
+        snapshot.stable != sent.lastStable ||
+        snapshot.selectedVessel != sent.lastVessel;
+    // Unchanged readings are still repeated now and then so clients can tell the link is alive
+    if (!changed && now - sent.lastSent < TELEMETRY_KEEPALIVE_MS) return false;
+
+    if (client->queueLen() >= TELEMETRY_MAX_QUEUED) {
+        wsClient.droppedFrames++;
+        return false;
+    }
+    return true;
+}
+
+void sendTelemetry(const TelemetrySnapshot& snapshot, const VesselConfig* vessel) {
+    unsigned long now = millis();
+
+    // Encode each format at most once, and only if a client is due a frame in it
+    AsyncWebSocketMessageBuffer* jsonBuffer = nullptr;
+    AsyncWebSocketMessageBuffer* binaryBuffer = nullptr;
+    char json[TELEMETRY_JSON_MAX];
+    size_t jsonLength = 0;
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    bool jsonReady = false;
+    bool binaryReady = false;
+
+    ClientsGuard guard;
+    for(int i = 0; i < numClients; i++) {
+        WSClient& wsClient = wsClients[i];
+        if(!wsClient.updatesEnabled) continue;
+        AsyncWebSocketClient * client = ws.client(wsClient.id);
+        if(!client || !telemetryDue(wsClient, client, snapshot, now)) continue;
+
+        if (wsClient.binaryTelemetry) {
+            if (!binaryReady) {
+                encodeBinaryTelemetry(snapshot, frame);
+                binaryBuffer = binaryFrames.acquire(frame, sizeof(frame));
+                binaryReady = true;
             }
+            // Every pooled buffer still queued somewhere: fall back to a private copy
+            if (binaryBuffer) {
+                client->binary(binaryBuffer);
+            } else {
+                client->binary(frame, sizeof(frame));
+            }
+        } else {
+            if (!jsonReady) {
+                jsonLength = encodeJsonTelemetry(snapshot, vessel, json, sizeof(json));
+                jsonBuffer = jsonFrames.acquire((const uint8_t*)json, jsonLength);
+                jsonReady = true;
+            }
+            if (jsonBuffer) {
+                client->text(jsonBuffer);
+            } else {
+                client->text(json, jsonLength);
+            }
+        }
 
-            String json;
-            serializeJson(doc, json);
+        TelemetrySent& sent = wsClient.sent[snapshot.channel];
+        wsClient.sentFrames++;
+        sent.lastSent = now;
+        sent.lastWeight = snapshot.weight;
+        sent.lastStable = snapshot.stable;
+        sent.lastVessel = snapshot.selectedVessel;
+        sent.hasSent = true;
+    }
+}
 
-            for(int i = 0; i < numClients; i++) {
-                if(wsClients[i].updatesEnabled) {
-                    AsyncWebSocketClient * client = ws.client(wsClients[i].id);
-                    if(client) client->text(json);
-                }
+// Send one frame to every client in the members bitmask of wsClients indices; clientsLock held
+void sendStreamBatch(uint32_t members, const uint8_t* frame, size_t len) {
+    AsyncWebSocketMessageBuffer* buffer = streamFrames.acquire(frame, len);
+    for (int i = 0; i < numClients; i++) {
+        if (!(members & (1u << i))) continue;
+        AsyncWebSocketClient* client = ws.client(wsClients[i].id);
+        if (!client) continue;
+        // Lagging clients lose whole batches; the sequence numbers show the gap
+        if (client->queueLen() >= STREAM_MAX_QUEUED) {
+            wsClients[i].droppedBatches++;
+            continue;
+        }
+        if (buffer) {
+            client->binary(buffer);
+        } else {
+            client->binary(frame, len);
+        }
+        wsClients[i].sentBatches++;
+    }
+}
+
+void sendStreamStats(unsigned long now) {
+    uint32_t head = scale->channel(streamChannel).getSamples().headSeq();
+    float seconds = (now - streamStatsStart) / 1000.0f;
+
+    for (int i = 0; i < numClients; i++) {
+        WSClient& wsClient = wsClients[i];
+        if (!wsClient.streaming) continue;
+        AsyncWebSocketClient* client = ws.client(wsClient.id);
+        if (client) {
+            StaticJsonDocument<128> doc;
+            JsonObject stats = doc.createNestedObject("stream");
+            stats["channel"] = streamChannel;
+            stats["sampleRate"] = (head - streamStatsSeq) / seconds;
+            stats["sentRate"] = wsClient.streamSamplesSent / seconds;
+            stats["lost"] = wsClient.streamSamplesLost;
+            stats["batch"] = wsClient.streamBatch;
+            char json[128];
+            size_t len = serializeJson(doc, json, sizeof(json));
+            client->text(json, len);
+        }
+        wsClient.streamSamplesSent = 0;
+    }
+
+    streamStatsStart = now;
+    streamStatsSeq = head;
+}
+
+// Start streaming to a client. It joins the clients already streaming with the same
+// batch size, so their frames are still encoded once.
+void startSampleStream(WSClient& wsClient, uint16_t batch) {
+    wsClient.streamBatch = batch;
+    wsClient.streamCursor = scale->channel(streamChannel).getSamples().headSeq();
+    wsClient.lastStreamSend = millis();
+    for (int i = 0; i < numClients; i++) {
+        const WSClient& other = wsClients[i];
+        if (&other == &wsClient || !other.streaming || other.streamBatch != batch) continue;
+        wsClient.streamCursor = other.streamCursor;
+        wsClient.lastStreamSend = other.lastStreamSend;
+        break;
+    }
+    wsClient.streamSamplesSent = 0;
+    wsClient.streamSamplesLost = 0;
+}
+
+// Send the samples a group of clients hasn't received yet; all members share the
+// cursor and batch size of the leader. clientsLock must be held from building
+// members until this returns.
+void pumpStreamGroup(const WSClient& leader, uint32_t members, const ScaleChannel& cell, uint32_t head, unsigned long now) {
+    const SampleRing<ScaleChannel::SAMPLE_BUFFER_SIZE>& ring = cell.getSamples();
+    uint16_t batch = leader.streamBatch;
+    uint32_t cursor = leader.streamCursor;
+    uint32_t pending = head - cursor;
+    if (pending == 0 || (pending < batch && now - leader.lastStreamSend < STREAM_MAX_LATENCY_MS)) return;
+
+    uint8_t frame[STREAM_HEADER_SIZE + STREAM_MAX_BATCH * STREAM_SAMPLE_SIZE];
+    uint32_t sent = 0;
+    uint32_t lost = 0;
+    while (pending > 0) {
+        uint16_t count = 0;
+        uint16_t take = pending < batch ? pending : batch;
+        for (uint16_t i = 0; i < take; i++) {
+            Sample sample;
+            if (ring.read(cursor + 1 + i, sample)) {
+                encodeStreamSample(frame + STREAM_HEADER_SIZE + count * STREAM_SAMPLE_SIZE,
+                                   sample.seq, sample.timestamp, sample.raw, cell.toWeight(sample.filtered));
+                count++;
+            } else {
+                lost++;
             }
         }
-        lastWebSocketUpdate = millis();
+        cursor += take;
+        pending -= take;
+
+        if (count > 0) {
+            encodeStreamHeader(frame, count);
+            sendStreamBatch(members, frame, STREAM_HEADER_SIZE + count * STREAM_SAMPLE_SIZE);
+            sent += count;
+        }
+    }
+
+    for (int i = 0; i < numClients; i++) {
+        if (!(members & (1u << i))) continue;
+        wsClients[i].streamCursor = cursor;
+        wsClients[i].lastStreamSend = now;
+        wsClients[i].streamSamplesSent += sent;
+        wsClients[i].streamSamplesLost += lost;
+    }
+}
+
+// Forward every new sample from the ring to streaming clients in batches
+void pumpSampleStream() {
+    PROFILE_SECTION(PROFILE_LOOP_STREAM);
+    ClientsGuard guard;
+    const ScaleChannel& cell = scale->channel(streamChannel);
+    uint32_t head = cell.getSamples().headSeq();
+    unsigned long now = millis();
+
+    // Clients on the same cursor and batch size form a group that shares encoded frames
+    uint32_t pumped = 0;
+    for (int i = 0; i < numClients; i++) {
+        const WSClient& leader = wsClients[i];
+        if (!leader.streaming || (pumped & (1u << i))) continue;
+        uint32_t members = 0;
+        for (int j = i; j < numClients; j++) {
+            const WSClient& other = wsClients[j];
+            if (other.streaming && other.streamBatch == leader.streamBatch && other.streamCursor == leader.streamCursor) {
+                members |= 1u << j;
+            }
+        }
+        pumped |= members;
+        pumpStreamGroup(leader, members, cell, head, now);
+    }
+
+    if (pumped == 0) {
+        streamStatsStart = now;
+        streamStatsSeq = head;
+    } else if (now - streamStatsStart >= STREAM_STATS_MS) {
+        sendStreamStats(now);
     }
 }
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len);
-void sendVesselList();
-void sendCalibrationSettings();
+void sendVesselPage(AsyncWebSocketClient* client, const char* afterName, int afterId, int limit, bool first);
+void sendCalibrationSettings(uint8_t channel);
+bool encodeVesselDelta(uint32_t version, String& json);
 
 void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len) {
+    PROFILE_SECTION(PROFILE_WEBSOCKET);
     AwsFrameInfo *info = (AwsFrameInfo*)arg;
     if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
         data[len] = 0;  // Ensure null termination
@@ -372,7 +983,15 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
             return;
         }
 
+        // Load cell the command is about; commands without one mean the first
+        int channel = doc["channel"] | 0;
+        if (channel < 0 || channel >= SCALE_CHANNELS) {
+            broadcastStatus("Invalid channel", true);
+            return;
+        }
+
         if (strcmp(command, "toggleUpdates") == 0) {
+            ClientsGuard guard;
             WSClient* wsClient = findClient(client->id());
             if (wsClient) {
                 wsClient->updatesEnabled = doc["enabled"];
@@ -381,18 +1000,109 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
             return;
         }
 
-        if (strcmp(command, "selectVessel") == 0) {
-            int index = doc["index"] | -1;
-            if (index >= 0 && index < vesselManager->getVesselCount()) {
-                display->setSelectedVessel(index);
-                StaticJsonDocument<200> response;
-                response["status"] = "Vessel selected";
-                response["selectedVessel"] = index;
+        if (strcmp(command, "subscribe") == 0) {
+            ClientsGuard guard;
+            WSClient* wsClient = findClient(client->id());
+            int interval = doc["interval"] | TELEMETRY_DEFAULT_MS;
+            float deadband = doc["deadband"] | 0.0f;
+            if (wsClient && interval >= TELEMETRY_TICK_MS && interval <= TELEMETRY_MAX_INTERVAL && deadband >= 0) {
+                wsClient->updatesEnabled = true;
+                wsClient->intervalMs = interval;
+                wsClient->deadband = deadband;
+                wsClient->stableOnly = doc["stableOnly"] | false;
+                // "channels": [0, 2] limits the frames to those load cells
+                JsonArray channels = doc["channels"];
+                wsClient->channelMask = channels.isNull() ? ALL_CHANNELS : 0;
+                for (JsonVariant c : channels) {
+                    int index = c | -1;
+                    if (index >= 0 && index < SCALE_CHANNELS) wsClient->channelMask |= 1u << index;
+                }
+                for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+                    wsClient->sent[c].hasSent = false;
+                }
+
+                StaticJsonDocument<256> response;
+                JsonObject subscription = response.createNestedObject("subscription");
+                subscription["interval"] = wsClient->intervalMs;
+                subscription["deadband"] = wsClient->deadband;
+                subscription["stableOnly"] = wsClient->stableOnly;
+                if (SCALE_CHANNELS > 1) {
+                    JsonArray subscribed = subscription.createNestedArray("channels");
+                    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+                        if (wsClient->channelMask & (1u << c)) subscribed.add(c);
+                    }
+                }
                 String jsonResponse;
                 serializeJson(response, jsonResponse);
-                ws.textAll(jsonResponse);
+                client->text(jsonResponse);
             } else {
-                broadcastStatus("Invalid vessel index", true);
+                broadcastStatus("Invalid subscription settings", true);
+            }
+            return;
+        }
+
+        if (strcmp(command, "stream") == 0) {
+            ClientsGuard guard;
+            WSClient* wsClient = findClient(client->id());
+            int batch = wsClient ? (doc["batch"] | (int)wsClient->streamBatch) : 0;
+            if (wsClient && batch >= 1 && batch <= STREAM_MAX_BATCH) {
+                bool enabled = doc["enabled"] | false;
+                // One channel streams at a time; naming another moves every streaming client over
+                if (doc.containsKey("channel") && channel != streamChannel) {
+                    streamChannel = channel;
+                    uint32_t head = scale->channel(streamChannel).getSamples().headSeq();
+                    for (int i = 0; i < numClients; i++) {
+                        wsClients[i].streamCursor = head;
+                    }
+                    streamStatsSeq = head;
+                }
+                // The batch size only applies to this client
+                if (enabled && (!wsClient->streaming || batch != wsClient->streamBatch)) {
+                    startSampleStream(*wsClient, batch);
+                }
+                wsClient->streamBatch = batch;
+                wsClient->streaming = enabled;
+                sendStatus(client, enabled ? "Sample stream enabled" : "Sample stream disabled");
+            } else {
+                sendStatus(client, "Invalid stream settings", true);
+            }
+            return;
+        }
+
+        if (strcmp(command, "setTime") == 0) {
+            // Browsers provide the time in AP mode, where NTP is unreachable
+            uint32_t clientTime = doc["time"] | 0;
+            if (time(nullptr) < HistoryStore::MIN_VALID_TIME && clientTime >= HistoryStore::MIN_VALID_TIME) {
+                struct timeval tv = { (time_t)clientTime, 0 };
+                settimeofday(&tv, nullptr);
+            }
+            return;
+        }
+
+        if (strcmp(command, "setFormat") == 0) {
+            ClientsGuard guard;
+            WSClient* wsClient = findClient(client->id());
+            const char* format = doc["format"] | "json";
+            if (wsClient && (strcmp(format, "json") == 0 || strcmp(format, "binary") == 0)) {
+                wsClient->binaryTelemetry = strcmp(format, "binary") == 0;
+                StaticJsonDocument<64> response;
+                response["format"] = format;
+                String jsonResponse;
+                serializeJson(response, jsonResponse);
+                client->text(jsonResponse);
+            } else {
+                broadcastStatus("Invalid telemetry format", true);
+            }
+            return;
+        }
+
+        if (strcmp(command, "selectVessel") == 0) {
+            int id = doc["id"] | 0;
+            if (vesselManager->hasVessel(id)) {
+                vesselSelectRequests[channel].store(id);
+                broadcastChannelStatus(channel, "Vessel selected");
+            } else {
+                broadcastStatus("Invalid vessel id", true);
             }
             return;
         }
@@ -404,9 +1114,8 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
                 float vesselWeight = vessel["vesselWeight"];
                 float spoolWeight = vessel["spoolWeight"];
                 
-                if (vesselManager->addVessel(name, vesselWeight, spoolWeight)) {
+                if (name && vesselManager->addVessel(name, vesselWeight, spoolWeight)) {
                     broadcastStatus("Vessel added");
-                    sendVesselList();  // Update all clients
                 } else {
                     broadcastStatus("Failed to add vessel", true);
                 }
@@ -415,16 +1124,15 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
         }
 
         if (strcmp(command, "updateVessel") == 0) {
-            int index = doc["index"] | -1;
+            int id = doc["id"] | 0;
             JsonObject vessel = doc["vessel"];
-            if (!vessel.isNull() && index >= 0) {
+            if (!vessel.isNull() && vessel["name"].is<const char*>()) {
                 const char* name = vessel["name"];
                 float vesselWeight = vessel["vesselWeight"];
                 float spoolWeight = vessel["spoolWeight"];
                 
-                if (vesselManager->updateVessel(index, name, vesselWeight, spoolWeight)) {
+                if (vesselManager->updateVessel(id, name, vesselWeight, spoolWeight)) {
                     broadcastStatus("Vessel updated");
-                    sendVesselList();  // Update all clients
                 } else {
                     broadcastStatus("Failed to update vessel", true);
                 }
@@ -433,10 +1141,9 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
         }
 
         if (strcmp(command, "deleteVessel") == 0) {
-            int index = doc["index"] | -1;
-            if (index >= 0 && vesselManager->deleteVessel(index)) {
+            int id = doc["id"] | 0;
+            if (vesselManager->deleteVessel(id)) {
                 broadcastStatus("Vessel deleted");
-                sendVesselList();  // Update all clients
             } else {
                 broadcastStatus("Failed to delete vessel", true);
             }
@@ -444,95 +1151,301 @@ void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *da
         }
 
         if (strcmp(command, "getVessels") == 0) {
-            sendVesselList();
+            // Paged: the reply's cursor, sent back as "after", fetches the next page
+            JsonObject after = doc["after"];
+            int limit = doc["limit"] | VESSEL_PAGE_SIZE;
+            if (limit < 1 || limit > VESSEL_PAGE_SIZE) limit = VESSEL_PAGE_SIZE;
+            sendVesselPage(client, after["name"] | "", after["id"] | 0, limit, after.isNull());
+            return;
+        }
+
+        if (strcmp(command, "syncVessels") == 0) {
+            // Replay the deltas a client missed; if the log no longer reaches back
+            // that far it starts over from the first page
+            uint32_t since = doc["since"] | 0;
+            uint32_t version = vesselBroadcastVersion;
+            bool replayed = since <= version && version - since <= VesselManager::CHANGE_LOG_SIZE;
+            for (uint32_t v = since + 1; replayed && v <= version; v++) {
+                String json;
+                replayed = encodeVesselDelta(v, json);
+                if (replayed) client->text(json);
+            }
+            if (!replayed) {
+                sendVesselPage(client, "", 0, VESSEL_PAGE_SIZE, true);
+            }
+            return;
+        }
+
+        if (strcmp(command, "getProfile") == 0) {
+#if PROFILER_ENABLED
+            StreamString json;
+            profiler.writeJson(json);
+            client->text(json);
+#else
+            sendStatus(client, "Profiler not enabled in this build", true);
+#endif
             return;
         }
 
         if (strcmp(command, "getCalibrationSettings") == 0) {
-            sendCalibrationSettings();
+            sendCalibrationSettings(channel);
             return;
         }
 
         if (strcmp(command, "tare") == 0) {
-            scale->tare();
-            broadcastStatus("Scale tared");
+            // Don't hold up the network task waiting for the scale to settle
+            tareRequestTime[channel] = millis();
+            tareRequests.fetch_or(1u << channel);
+            broadcastChannelStatus(channel, "Taring...");
             return;
         }
 
         if (strcmp(command, "calibrate") == 0) {
             float knownWeight = doc["weight"] | 0.0f;
-            if (knownWeight > 0) {
-                // Note: Scale should already be tared with nothing on it before starting calibration
-                if (calibrateScale(knownWeight)) {
-                    broadcastStatus("Scale calibrated successfully. Remove calibration weight and tare again if needed.");
-                } else {
-                    broadcastStatus("Calibration failed - unstable readings. Make sure to tare with nothing on the scale BEFORE placing the calibration weight.", true);
-                }
+            if (knownWeight <= 0) {
+                broadcastStatus("Invalid calibration weight", true);
+            } else if (calibration.request(knownWeight, client->id(), Calibration::FACTOR, channel)) {
+                // Note: Scale should already be tared with nothing on it before starting calibration.
+                // loop() drives the measurement and reports progress to this client.
+                broadcastChannelStatus(channel, "Calibrating...");
             } else {
+                broadcastStatus("Calibration already in progress", true);
+            }
+            return;
+        }
+
+        if (strcmp(command, "addCalibrationPoint") == 0) {
+            float pointWeight = doc["weight"] | 0.0f;
+            if (pointWeight <= 0) {
                 broadcastStatus("Invalid calibration weight", true);
+            } else if (calibration.request(pointWeight, client->id(), Calibration::POINT, channel)) {
+                broadcastChannelStatus(channel, "Calibrating...");
+            } else {
+                broadcastStatus("Calibration already in progress", true);
             }
             return;
         }
 
+        if (strcmp(command, "getCalibrationPoints") == 0) {
+            sendCalibrationPoints(channel);
+            return;
+        }
+
+        if (strcmp(command, "clearCalibrationPoints") == 0) {
+            scale->channel(channel).clearCalibrationPoints();
+            saveCalibrationTable(channel);
+            broadcastChannelStatus(channel, "Calibration points cleared");
+            sendCalibrationPoints(channel);
+            return;
+        }
+
         if (strcmp(command, "setCalibrationMargin") == 0) {
             float margin = doc["margin"] | 0.02f;
             if (margin > 0 && margin < 1.0) {
-                scale->setCalibrationMargin(margin);
-                preferences.begin("scale", false);
+                scale->channel(channel).setCalibrationMargin(margin);
+                beginCalibrationPreferences(channel, false);
                 preferences.putFloat("margin", margin);
                 preferences.end();
-                broadcastStatus("Calibration margin updated");
+                broadcastChannelStatus(channel, "Calibration margin updated");
             } else {
                 broadcastStatus("Invalid calibration margin (must be between 0 and 1)", true);
             }
             return;
         }
 
+        if (strcmp(command, "setFilter") == 0) {
+            const char* stage = doc["stage"];
+            // The filter settings apply to every channel
+            FilterConfig config = scale->channel(0).getFilterConfig();
+            // Fields left out keep their current value
+            bool valid = true;
+
+            if (stage && strcmp(stage, "outlier") == 0) {
+                float sigma = doc["sigma"] | config.outlierSigma;
+                valid = sigma >= 1.0f && sigma <= 10.0f;
+                config.outlierEnabled = doc["enabled"] | config.outlierEnabled;
+                config.outlierSigma = sigma;
+            } else if (stage && strcmp(stage, "median") == 0) {
+                int window = doc["window"] | (int)config.medianWindow;
+                valid = window >= 1 && window <= MedianFilter::MAX_WINDOW;
+                config.medianEnabled = doc["enabled"] | config.medianEnabled;
+                config.medianWindow = window;
+            } else if (stage && strcmp(stage, "ema") == 0) {
+                float alpha = doc["alpha"] | config.emaAlpha;
+                valid = alpha > 0.0f && alpha <= 1.0f;
+                config.emaEnabled = doc["enabled"] | config.emaEnabled;
+                config.emaAlpha = alpha;
+            } else {
+                valid = false;
+            }
+
+            if (valid) {
+                for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+                    scale->channel(c).setFilterConfig(config);
+                }
+                saveFilterConfig(config);
+                broadcastStatus("Filter settings updated");
+                sendCalibrationSettings(channel);
+            } else {
+                broadcastStatus("Invalid filter settings", true);
+            }
+            return;
+        }
+
         Serial.println("Unknown command");
         broadcastStatus("Unknown command", true);
     }
 }
 
-void sendCalibrationSettings() {
-    StaticJsonDocument<256> doc;
-    doc["calibrationFactor"] = scale->getCalibrationFactor();
-    doc["calibrationMargin"] = scale->getCalibrationMargin();
+void fillCalibrationSettings(JsonObject doc, uint8_t channel) {
+    ScaleChannel& cell = scale->channel(channel);
+    doc["calibrationFactor"] = cell.getCalibrationFactor();
+    doc["calibrationMargin"] = cell.getCalibrationMargin();
+    doc["offset"] = cell.getOffset();
+
+    FilterConfig config = cell.getFilterConfig();
+    JsonObject filter = doc.createNestedObject("filter");
+    JsonObject outlier = filter.createNestedObject("outlier");
+    outlier["enabled"] = config.outlierEnabled;
+    outlier["sigma"] = config.outlierSigma;
+    JsonObject median = filter.createNestedObject("median");
+    median["enabled"] = config.medianEnabled;
+    median["window"] = config.medianWindow;
+    JsonObject ema = filter.createNestedObject("ema");
+    ema["enabled"] = config.emaEnabled;
+    ema["alpha"] = config.emaAlpha;
+}
+
+void sendCalibrationSettings(uint8_t channel) {
+    StaticJsonDocument<384> doc;
+    fillCalibrationSettings(doc.to<JsonObject>(), channel);
+    doc["channel"] = channel;
     String json;
     serializeJson(doc, json);
     ws.textAll(json);
 }
 
-void sendVesselList() {
-    StaticJsonDocument<1024> doc;
-    JsonArray vessels = doc.createNestedArray("vessels");
-    
-    for (int i = 0; i < vesselManager->getVesselCount(); i++) {
-        VesselConfig* vessel = vesselManager->getVessel(i);
-        if (vessel) {
-            JsonObject v = vessels.createNestedObject();
-            v["name"] = vessel->name;
-            v["vesselWeight"] = vessel->vesselWeight;
-            v["spoolWeight"] = vessel->spoolWeight;
-        }
+void fillCalibrationPoints(JsonObject doc, uint8_t channel) {
+    CalibrationTable table = scale->channel(channel).getCalibrationTable();
+    JsonArray points = doc.createNestedArray("calibrationPoints");
+    for (uint8_t i = 0; i < table.size(); i++) {
+        JsonObject p = points.createNestedObject();
+        p["counts"] = table.getPoint(i).counts;
+        p["weight"] = table.getPoint(i).grams;
     }
-    
-    // Include the selected vessel index
-    doc["selectedVessel"] = vesselManager->getSelectedVessel();
+}
+
+void sendCalibrationPoints(uint8_t channel) {
+    StaticJsonDocument<512> doc;
+    fillCalibrationPoints(doc.to<JsonObject>(), channel);
+    doc["channel"] = channel;
     String json;
     serializeJson(doc, json);
     ws.textAll(json);
 }
 
+void sendVesselPage(AsyncWebSocketClient* client, const char* afterName, int afterId, int limit, bool first) {
+    // Room for a full page with every name copied at its longest
+    StaticJsonDocument<3072> doc;
+    fillVesselPage(doc.to<JsonObject>(), *vesselManager, vesselBroadcastVersion, afterName, afterId, limit, first);
+    String json;
+    serializeJson(doc, json);
+    client->text(json);
+}
+
+// Everything a client needs after connecting, in one message: the first
+// vessels with the selection and version, calibration and the current weight.
+// The rest of the vessel list follows from the page cursor. Calibration and
+// weight are channel 0's; "channels" tells the client how many there are.
+void sendSnapshot(AsyncWebSocketClient* client) {
+    StaticJsonDocument<2048> doc;
+    JsonObject snapshot = doc.createNestedObject("snapshot");
+    snapshot["channels"] = SCALE_CHANNELS;
+    fillVesselPage(snapshot, *vesselManager, vesselBroadcastVersion, "", 0, SNAPSHOT_VESSELS, true);
+    fillCalibrationSettings(snapshot, 0);
+    fillCalibrationPoints(snapshot, 0);
+
+    ScaleChannel& cell = scale->channel(0);
+    float weight = cell.getWeight();
+    snapshot["weight"] = weight;
+    snapshot["stable"] = cell.isStable();
+    VesselConfig vessel;
+    if (vesselManager->getSelectedVessel(0, vessel)) {
+        snapshot["filamentWeight"] = weight - vessel.vesselWeight - vessel.spoolWeight;
+    }
+    String json;
+    serializeJson(doc, json);
+    client->text(json);
+}
+
+// {"vesselDelta": {"version", "op": "add"|"update"|"delete"|"select", "id", "vessel"?, "channel"?}}
+// Added and updated vessels are sent as they are now; any later change
+// follows as its own delta. False once the change has left the log.
+bool encodeVesselDelta(uint32_t version, String& json) {
+    VesselManager::Change change;
+    if (!vesselManager->getChange(version, change)) return false;
+
+    StaticJsonDocument<256> doc;
+    JsonObject delta = doc.createNestedObject("vesselDelta");
+    delta["version"] = version;
+    delta["id"] = change.id;
+    switch (change.type) {
+        case VesselManager::VESSEL_ADDED:    delta["op"] = "add"; break;
+        case VesselManager::VESSEL_UPDATED:  delta["op"] = "update"; break;
+        case VesselManager::VESSEL_DELETED:  delta["op"] = "delete"; break;
+        case VesselManager::VESSEL_SELECTED: delta["op"] = "select"; break;
+    }
+    if (change.type == VesselManager::VESSEL_SELECTED) {
+        delta["channel"] = change.channel;
+    }
+    if (change.type == VesselManager::VESSEL_ADDED || change.type == VesselManager::VESSEL_UPDATED) {
+        VesselConfig vessel;
+        if (vesselManager->getVessel(change.id, vessel)) fillVessel(delta.createNestedObject("vessel"), &vessel);
+    }
+    serializeJson(doc, json);
+    return true;
+}
+
+// Push vessel changes made since the last call to every client. Changes that
+// already left the log can't be replayed; clients are told to resync instead.
+void broadcastVesselChanges() {
+    PROFILE_SECTION(PROFILE_LOOP_VESSEL_SYNC);
+    uint32_t version = vesselManager->getVersion();
+    if (ws.count() == 0) {
+        vesselBroadcastVersion = version;
+        return;
+    }
+    while (vesselBroadcastVersion != version) {
+        String json;
+        if (encodeVesselDelta(vesselBroadcastVersion + 1, json)) {
+            vesselBroadcastVersion = vesselBroadcastVersion + 1;
+        } else {
+            vesselBroadcastVersion = version;
+            StaticJsonDocument<64> doc;
+            doc["vesselResync"]["version"] = version;
+            serializeJson(doc, json);
+        }
+        ws.textAll(json);
+    }
+}
+
 void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
                      void *arg, uint8_t *data, size_t len) {
     switch (type) {
         case WS_EVT_CONNECT:
             Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
-            addClient(client->id());
+            {
+                ClientsGuard guard;
+                addClient(client->id());
+            }
+            sendSnapshot(client);
             break;
         case WS_EVT_DISCONNECT:
             Serial.printf("WebSocket client #%u disconnected\n", client->id());
-            removeClient(client->id());
+            {
+                ClientsGuard guard;
+                removeClient(client->id());
+            }
             break;
         case WS_EVT_DATA:
             handleWebSocketMessage(client, arg, data, len);
@@ -543,8 +1456,93 @@ void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
     }
 }
 
+// GET /history?from=<unix>&to=<unix>&res=<seconds>
+// Streams the range as CSV. Without res the finest tier still covering `from` is used.
+void handleHistoryRequest(AsyncWebServerRequest* request) {
+    uint32_t now = time(nullptr);
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : now;
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : to - 3600;
+    if (from > to) {
+        request->send(400, "text/plain", "from must not be after to");
+        return;
+    }
+
+    int tier = -1;
+    if (request->hasParam("res")) {
+        tier = HistoryStore::findTier(request->getParam("res")->value().toInt());
+        if (tier < 0) {
+            request->send(400, "text/plain", "res must be 1, 60 or 3600");
+            return;
+        }
+    } else {
+        for (uint8_t i = 0; i < HistoryStore::TIER_COUNT && tier < 0; i++) {
+            if (now - from <= HistoryStore::retention(i)) tier = i;
+        }
+        if (tier < 0) tier = HistoryStore::TIER_COUNT - 1;
+    }
+
+    // The reader lives as long as the response's fill callback
+    std::shared_ptr<HistoryReader> reader = std::make_shared<HistoryReader>(*history, tier, from, to);
+    AsyncWebServerResponse* response = request->beginChunkedResponse("text/csv",
+        [reader](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+            return reader->read(buffer, maxLen);
+        });
+    request->send(response);
+}
+
+// GET /metrics in Prometheus text format
+void handleMetricsRequest(AsyncWebServerRequest* request) {
+    AsyncResponseStream* out = request->beginResponseStream("text/plain; version=0.0.4");
+
+    writeMetric(*out, "scale_samples_total", "counter", "HX711 conversions read", metrics.samplesTaken.get());
+    writeMetric(*out, "scale_samples_missed_total", "counter",
+                "Waits for an HX711 conversion that timed out", metrics.samplesMissed.get());
+    metrics.readLatency.write(*out, "scale_read_latency_seconds", "Time to clock one conversion out of the HX711");
+    metrics.loopTime.write(*out, "loop_iteration_seconds", "Duration of one pass of the main loop");
+    metrics.frameTime.write(*out, "display_frame_seconds", "Time to draw and flush one display frame");
+
+    writeMetricHeader(*out, "vessel_store_writes_total", "counter", "Vessel persistence writes");
+    out->printf("vessel_store_writes_total{target=\"file\"} %u\n", (unsigned)metrics.vesselFileWrites.get());
+    out->printf("vessel_store_writes_total{target=\"nvs\"} %u\n", (unsigned)metrics.vesselNvsWrites.get());
+
+    writeMetric(*out, "heap_free_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+    writeMetric(*out, "heap_min_free_bytes", "gauge", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    writeMetric(*out, "heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+
+    // Per WebSocket client; the client's send queue is where AsyncTCP backs up
+    ClientsGuard guard;
+    writeMetricHeader(*out, "ws_frames_sent_total", "counter", "WebSocket frames sent");
+    for (int i = 0; i < numClients; i++) {
+        out->printf("ws_frames_sent_total{client=\"%u\",type=\"telemetry\"} %u\n",
+                    (unsigned)wsClients[i].id, (unsigned)wsClients[i].sentFrames);
+        out->printf("ws_frames_sent_total{client=\"%u\",type=\"stream\"} %u\n",
+                    (unsigned)wsClients[i].id, (unsigned)wsClients[i].sentBatches);
+    }
+    writeMetricHeader(*out, "ws_frames_dropped_total", "counter", "WebSocket frames skipped because the client was backed up");
+    for (int i = 0; i < numClients; i++) {
+        out->printf("ws_frames_dropped_total{client=\"%u\",type=\"telemetry\"} %u\n",
+                    (unsigned)wsClients[i].id, (unsigned)wsClients[i].droppedFrames);
+        out->printf("ws_frames_dropped_total{client=\"%u\",type=\"stream\"} %u\n",
+                    (unsigned)wsClients[i].id, (unsigned)wsClients[i].droppedBatches);
+    }
+    writeMetricHeader(*out, "ws_queue_length", "gauge", "Messages waiting in the client's send queue");
+    for (int i = 0; i < numClients; i++) {
+        AsyncWebSocketClient* client = ws.client(wsClients[i].id);
+        if (!client) continue;
+        out->printf("ws_queue_length{client=\"%u\"} %u\n", (unsigned)wsClients[i].id, (unsigned)client->queueLen());
+    }
+
+    request->send(out);
+}
+
 void setupWebServer() {
-    server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+    server.on("/history", HTTP_GET, handleHistoryRequest);
+    server.on("/metrics", HTTP_GET, handleMetricsRequest);
+    webAssets.begin();
+    server.addHandler(&webAssets);
     ws.onEvent(onWebSocketEvent);
     server.addHandler(&ws);
+    jsonFrames.begin(ws, 128);
+    binaryFrames.begin(ws, TELEMETRY_FRAME_SIZE);
+    streamFrames.begin(ws, STREAM_HEADER_SIZE + STREAM_DEFAULT_BATCH * STREAM_SAMPLE_SIZE);
 }
@@ -0,0 +1,108 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+// Counters and histograms behind GET /metrics (Prometheus text format).
+//
+// Every update is one relaxed atomic add on a 32-bit word, which is lock-free
+// on the ESP32-C6, so hot paths and ISRs can record without taking a lock. A
+// scrape reads each word on its own; a histogram's buckets and sum may be a
+// few observations apart, which Prometheus tolerates. Counters wrap at 2^32,
+// which looks like a counter reset to the scraper. A histogram's sum is the
+// exception: microseconds of loop time reach 2^32 in about 71 minutes, so it
+// is a 64-bit value updated under a spinlock.
+class Counter {
+public:
+    Counter() : value(0) {}
+
+    void inc(uint32_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint32_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> value;
+};
+
+// Durations in microseconds, counted into N buckets plus +Inf
+template <size_t N>
+class Histogram {
+public:
+    explicit Histogram(const uint32_t (&upperBounds)[N]) : sum(0) {
+        memcpy(bounds, upperBounds, sizeof(bounds));
+        sumLock = portMUX_INITIALIZER_UNLOCKED;
+    }
+
+    void observe(uint32_t micros) {
+        size_t i = 0;
+        while (i < N && micros > bounds[i]) i++;
+        buckets[i].inc();
+        portENTER_CRITICAL(&sumLock);
+        sum += micros;
+        portEXIT_CRITICAL(&sumLock);
+    }
+
+    // Prometheus text, durations converted to seconds
+    void write(Print& out, const char* name, const char* help, const char* labels = "") const {
+        out.printf("# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+        const char* separator = labels[0] ? "," : "";
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < N; i++) {
+            cumulative += buckets[i].get();
+            out.printf("%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, separator, bounds[i] / 1e6, (unsigned)cumulative);
+        }
+        cumulative += buckets[N].get();
+        out.printf("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, (unsigned)cumulative);
+        const char* open = labels[0] ? "{" : "";
+        const char* close = labels[0] ? "}" : "";
+        portENTER_CRITICAL(&sumLock);
+        uint64_t sumMicros = sum;
+        portEXIT_CRITICAL(&sumLock);
+        out.printf("%s_sum%s%s%s %.6f\n", name, open, labels, close, sumMicros / 1e6);
+        out.printf("%s_count%s%s%s %u\n", name, open, labels, close, (unsigned)cumulative);
+    }
+
+private:
+    uint32_t bounds[N];
+    Counter buckets[N + 1];
+    mutable portMUX_TYPE sumLock;
+    uint64_t sum;                   // Microseconds, guarded by sumLock
+};
+
+inline void writeMetricHeader(Print& out, const char* name, const char* type, const char* help) {
+    out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+inline void writeMetric(Print& out, const char* name, const char* type, const char* help, uint32_t value) {
+    writeMetricHeader(out, name, type, help);
+    out.printf("%s %u\n", name, (unsigned)value);
+}
+
+static constexpr uint32_t READ_LATENCY_BOUNDS_US[] = {50, 100, 200, 500, 1000, 2000, 5000};
+static constexpr uint32_t LOOP_TIME_BOUNDS_US[] = {100, 500, 1000, 5000, 10000, 50000, 100000, 500000};
+static constexpr uint32_t FRAME_TIME_BOUNDS_US[] = {1000, 5000, 10000, 20000, 50000, 100000};
+
+struct Metrics {
+    Metrics()
+        : readLatency(READ_LATENCY_BOUNDS_US),
+          loopTime(LOOP_TIME_BOUNDS_US),
+          frameTime(FRAME_TIME_BOUNDS_US) {}
+
+    // Sampling task
+    Counter samplesTaken;
+    Counter samplesMissed;          // Waits for a conversion that timed out
+    Histogram<7> readLatency;       // Clocking one conversion out of the HX711
+
+    Histogram<8> loopTime;          // One pass of loop()
+    Histogram<6> frameTime;         // Drawing and flushing one display frame
+
+    // Vessel persistence
+    Counter vesselFileWrites;       // Slots written to the vessel table file
+    Counter vesselNvsWrites;        // Selection writes to NVS
+};
+
+extern Metrics metrics;
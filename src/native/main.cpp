@@ -0,0 +1,162 @@
+// Host build of the scale pipeline, menu and vessel store (pio run -e native).
+//
+// Runs a scripted session against the simulated load cell: tare, quick-add
+// a vessel through the menu, then let filament drain off the spool while the
+// display is updated like loop() does. Vessels and the selection persist in
+// <dir>/fs and <dir>/nvs across runs, display frames are dumped to
+// <dir>/display.pbm and .txt, and the metrics are printed at the end.
+//
+//   program [dir] [seconds of consumption]
+#include <Arduino.h>
+#include <FS.h>
+#include <Preferences.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include "config.h"
+#include "vessel_manager.h"
+#include "display_ui.h"
+#include "scale.h"
+#include "metrics.h"
+#include "profiler.h"
+
+SimLoadCell loadCells[HX711_CHIPS];
+Scale* scale;
+VesselManager* vesselManager;
+DisplayUI* display;
+Metrics metrics;
+#if PROFILER_ENABLED
+Profiler profiler;
+#endif
+
+static const float VESSEL_WEIGHT = 182.0f;
+static const float SPOOL_WEIGHT = 246.0f;
+static const float CONSUMPTION_GRAMS_PER_HOUR = 120.0f;
+
+// The scripted session runs on channel 0; any other load cells hold a fixed weight
+static void settle(float grams) {
+    loadCells[0].setWeight(grams);
+    scale->channel(0).waitForSamples(STABILITY_WINDOW, Scale::STABILITY_TIMEOUT);
+    float weight;
+    if (!scale->channel(0).waitForStable(Scale::STABILITY_TIMEOUT, weight)) {
+        Serial.printf("Reading did not settle at %.1fg\n", grams);
+    }
+}
+
+// Press the button and run loop()'s part of the capture until it completes
+static void captureQuickAddStep() {
+    display->handleButton();
+    while (display->isCapturing()) {
+        display->pumpQuickAdd();
+        delay(10);
+    }
+}
+
+static void quickAddVessel() {
+    display->handleButton();
+    // Scroll to the "Quick Add" entry, which sits before the first vessel
+    for (int i = 0; i <= vesselManager->getVesselCount() && display->getSelectedVessel() != -1; i++) {
+        display->handleRotary(-1);
+    }
+
+    settle(VESSEL_WEIGHT);
+    display->handleButton();
+    captureQuickAddStep();
+    settle(VESSEL_WEIGHT + SPOOL_WEIGHT + 1000.0f);
+    captureQuickAddStep();
+}
+
+static void printMetrics() {
+    Serial.println();
+    writeMetric(Serial, "scale_samples_total", "counter", "HX711 conversions read", metrics.samplesTaken.get());
+    writeMetric(Serial, "scale_samples_missed_total", "counter", "Waits for a conversion that timed out",
+                metrics.samplesMissed.get());
+    metrics.readLatency.write(Serial, "scale_read_latency_seconds", "Time to clock one conversion out of the HX711");
+    metrics.frameTime.write(Serial, "display_frame_seconds", "Time to draw and flush one display frame");
+    writeMetric(Serial, "vessel_file_writes_total", "counter", "Vessel slots written to flash",
+                metrics.vesselFileWrites.get());
+    writeMetric(Serial, "vessel_nvs_writes_total", "counter", "Vessel selection writes to NVS",
+                metrics.vesselNvsWrites.get());
+
+    Serial.println();
+    for (uint8_t chip = 0; chip < HX711_CHIPS; chip++) {
+        SimHx711::Stats stats = loadCells[chip].getStats();
+        Serial.printf("HX711 %u: %u conversions, %u read, %u overwritten, %u truncated, %u power-downs\n", chip,
+                      (unsigned)stats.conversions, (unsigned)stats.wordsRead, (unsigned)stats.overwritten,
+                      (unsigned)stats.truncatedReads, (unsigned)stats.powerDowns);
+    }
+    Serial.printf("Display: %u tiles sent\n", (unsigned)U8G2::tilesSent());
+#if PROFILER_ENABLED
+    Serial.println();
+    profiler.dump(Serial);
+#endif
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : "sim";
+    int seconds = argc > 2 ? atoi(argv[2]) : 90;
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/nvs").c_str(), 0755);
+    Preferences::setStorageDir(dir + "/nvs");
+    U8G2::setDumpPath((dir + "/display").c_str());
+    FS flash(dir + "/fs");
+
+    for (uint8_t chip = 0; chip < HX711_CHIPS; chip++) {
+        loadCells[chip].setNoise(40.0f);
+        loadCells[chip].setWeight(chip * 100.0f);
+        loadCells[chip].setWeightB(50.0f + chip * 100.0f);
+    }
+    scale = new Scale();
+    scale->init();
+    for (uint8_t c = 0; c < SCALE_CHANNELS; c++) {
+        // Input B reads at a quarter of the input A gain
+        float gain = c % Scale::INPUTS == 1 ? 0.25f : 1.0f;
+        scale->channel(c).setCalibrationFactor(loadCells[0].getCountsPerGram() * gain);
+        scale->channel(c).setOffset(loadCells[0].getZeroCounts() * gain);
+    }
+    settle(0.0f);
+    scale->channel(0).tare();
+
+    vesselManager = new VesselManager(flash);
+    display = new DisplayUI();
+    display->init();
+
+    quickAddVessel();
+    int vesselId = display->getSelectedVessel();
+    VesselConfig vessel;
+    if (display->getMenuState() != MAIN_SCREEN || !vesselManager->getVessel(vesselId, vessel)) {
+        Serial.println("Quick add did not produce a vessel");
+        return 1;
+    }
+    Serial.printf("Added \"%s\": vessel %.1fg, spool %.1fg\n", vessel.name, vessel.vesselWeight, vessel.spoolWeight);
+
+    // Filament drains at a constant rate from here on
+    float full = VESSEL_WEIGHT + SPOOL_WEIGHT + 1000.0f;
+    loadCells[0].setProfile([full](float t) {
+        return full - t * CONSUMPTION_GRAMS_PER_HOUR / 3600.0f;
+    });
+
+    unsigned long start = millis();
+    unsigned long lastReport = 0;
+    while (millis() - start < (unsigned long)seconds * 1000) {
+        ScaleChannel& cell = scale->channel(0);
+        display->showWeight(cell.getWeight(), &vessel);
+        if (millis() - lastReport >= 5000) {
+            lastReport = millis();
+            Serial.printf("t=%3lus weight=%.1fg stable=%d", (lastReport - start) / 1000,
+                          cell.getWeight(), cell.isStable());
+            float rate = cell.getConsumptionRate();
+            if (!isnan(rate)) Serial.printf(" rate=%.1fg/h", -rate);
+            for (uint8_t c = 1; c < SCALE_CHANNELS; c++) {
+                Serial.printf(" ch%u=%.1fg", c, scale->channel(c).getWeight());
+            }
+            Serial.println();
+        }
+        delay(100);
+    }
+
+    // Let the vessel store write what the session changed
+    delay(VesselStore::DEBOUNCE_MS + 500);
+    printMetrics();
+    return 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <stdint.h>
+#include "config.h"
+
+// Section profiler: PROFILE_SECTION(id) times the rest of the enclosing scope
+// with the CPU cycle counter and counts the duration into a fixed-bucket
+// histogram for that section. Each iteration of loop() is also timed; one
+// that runs over PROFILER_LOOP_BUDGET_US is logged with the loop section
+// that took longest.
+//
+// Built without PROFILER_ENABLED every probe compiles to nothing.
+enum ProfileSection : uint8_t {
+    // Run on the loop task, in this order
+    PROFILE_LOOP_INPUT,
+    PROFILE_LOOP_CALIBRATION,
+    PROFILE_LOOP_WEIGHT,
+    PROFILE_LOOP_HISTORY,
+    PROFILE_LOOP_STREAM,
+    PROFILE_LOOP_VESSEL_SYNC,
+    PROFILE_LOOP_TELEMETRY,
+    PROFILE_LOOP_SECTIONS,
+
+    // Other tasks
+    PROFILE_HX711_READ = PROFILE_LOOP_SECTIONS,
+    PROFILE_DISPLAY_RENDER,
+    PROFILE_DISPLAY_FLUSH,
+    PROFILE_VESSEL_PERSIST,
+    PROFILE_WEBSOCKET,
+    PROFILE_SECTION_COUNT
+};
+
+#if PROFILER_ENABLED
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_cpu.h>
+#include "metrics.h"
+
+class Profiler {
+public:
+    static constexpr size_t BUCKETS = 9;
+
+    Profiler() : cyclesPerUs(F_CPU / 1000000), loopStart(0), worstSection(0), worstCycles(0), lastStallLog(0), suppressedStalls(0) {
+        for (size_t i = 0; i < PROFILE_SECTION_COUNT; i++) maxUs[i].store(0, std::memory_order_relaxed);
+    }
+
+    void begin() {
+        cyclesPerUs = ESP.getCpuFreqMHz();
+    }
+
+    void record(ProfileSection section, uint32_t cycles) {
+        uint32_t us = cycles / cyclesPerUs;
+        Stats& stats = sections[section];
+        size_t i = 0;
+        while (i < BUCKETS && us > BOUNDS_US[i]) i++;
+        stats.buckets[i].inc();
+        stats.sumUs.inc(us);
+
+        uint32_t max = maxUs[section].load(std::memory_order_relaxed);
+        while (us > max && !maxUs[section].compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+
+        // Only loop sections run on the loop task, so this needs no locking
+        if (section < PROFILE_LOOP_SECTIONS && cycles > worstCycles) {
+            worstCycles = cycles;
+            worstSection = section;
+        }
+    }
+
+    void beginLoop() {
+        loopStart = esp_cpu_get_cycle_count();
+        worstCycles = 0;
+    }
+
+    void endLoop() {
+        uint32_t us = (esp_cpu_get_cycle_count() - loopStart) / cyclesPerUs;
+        if (us <= PROFILER_LOOP_BUDGET_US) return;
+
+        // Logging every stall would stall the loop on the serial port
+        unsigned long now = millis();
+        if (now - lastStallLog < STALL_LOG_INTERVAL_MS) {
+            suppressedStalls++;
+            return;
+        }
+        if (worstCycles > 0) {
+            Serial.printf("Loop stall: %u us, %s took %u us", (unsigned)us,
+                          sectionName(worstSection), (unsigned)(worstCycles / cyclesPerUs));
+        } else {
+            Serial.printf("Loop stall: %u us outside the profiled sections", (unsigned)us);
+        }
+        if (suppressedStalls > 0) {
+            Serial.printf(" (%u more not logged)", (unsigned)suppressedStalls);
+        }
+        Serial.println();
+        lastStallLog = now;
+        suppressedStalls = 0;
+    }
+
+    // Table for the serial console
+    void dump(Print& out) const {
+        out.printf("%-18s %8s %9s %9s", "section", "count", "mean_us", "max_us");
+        for (size_t i = 0; i < BUCKETS; i++) {
+            char label[12];
+            snprintf(label, sizeof(label), "<=%u", (unsigned)BOUNDS_US[i]);
+            out.printf(" %8s", label);
+        }
+        out.printf(" %8s\n", ">");
+        for (size_t s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            uint32_t count = sectionCount(s);
+            out.printf("%-18s %8u %9u %9u", sectionName(s), (unsigned)count,
+                       (unsigned)(count ? sections[s].sumUs.get() / count : 0),
+                       (unsigned)maxUs[s].load(std::memory_order_relaxed));
+            for (size_t i = 0; i <= BUCKETS; i++) out.printf(" %8u", (unsigned)sections[s].buckets[i].get());
+            out.println();
+        }
+    }
+
+    // {"profile": {"bounds": [...], "sections": {"name": {"count", "sumUs", "maxUs", "buckets": [...]}}}}
+    void writeJson(Print& out) const {
+        out.print("{\"profile\":{\"bounds\":[");
+        for (size_t i = 0; i < BUCKETS; i++) out.printf(i ? ",%u" : "%u", (unsigned)BOUNDS_US[i]);
+        out.print("],\"sections\":{");
+        for (size_t s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            out.printf("%s\"%s\":{\"count\":%u,\"sumUs\":%u,\"maxUs\":%u,\"buckets\":[", s ? "," : "",
+                       sectionName(s), (unsigned)sectionCount(s), (unsigned)sections[s].sumUs.get(),
+                       (unsigned)maxUs[s].load(std::memory_order_relaxed));
+            for (size_t i = 0; i <= BUCKETS; i++) out.printf(i ? ",%u" : "%u", (unsigned)sections[s].buckets[i].get());
+            out.print("]}");
+        }
+        out.print("}}}");
+    }
+
+    static const char* sectionName(size_t section) {
+        static const char* const NAMES[PROFILE_SECTION_COUNT] = {
+            "loop.input", "loop.calibration", "loop.weight", "loop.history",
+            "loop.stream", "loop.vessel_sync", "loop.telemetry",
+            "hx711.read", "display.render", "display.flush", "vessel.persist", "ws.message"
+        };
+        return section < PROFILE_SECTION_COUNT ? NAMES[section] : "?";
+    }
+
+private:
+    static constexpr uint32_t BOUNDS_US[BUCKETS] = {10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000};
+    static constexpr unsigned long STALL_LOG_INTERVAL_MS = 1000;
+
+    struct Stats {
+        Counter buckets[BUCKETS + 1];
+        Counter sumUs;
+    };
+
+    uint32_t sectionCount(size_t section) const {
+        uint32_t count = 0;
+        for (size_t i = 0; i <= BUCKETS; i++) count += sections[section].buckets[i].get();
+        return count;
+    }
+
+    uint32_t cyclesPerUs;
+    Stats sections[PROFILE_SECTION_COUNT];
+    std::atomic<uint32_t> maxUs[PROFILE_SECTION_COUNT];
+
+    // Loop task only
+    uint32_t loopStart;
+    uint8_t worstSection;
+    uint32_t worstCycles;
+    unsigned long lastStallLog;
+    uint32_t suppressedStalls;
+};
+
+constexpr uint32_t Profiler::BOUNDS_US[Profiler::BUCKETS];
+
+extern Profiler profiler;
+
+class ScopedProfile {
+public:
+    explicit ScopedProfile(ProfileSection section) : section(section), start(esp_cpu_get_cycle_count()) {}
+    ~ScopedProfile() { profiler.record(section, esp_cpu_get_cycle_count() - start); }
+
+private:
+    ProfileSection section;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SECTION(section) ScopedProfile PROFILE_CONCAT(profile_, __LINE__)(section)
+#define PROFILE_LOOP_BEGIN() profiler.beginLoop()
+#define PROFILE_LOOP_END() profiler.endLoop()
+
+#else
+
+#define PROFILE_SECTION(section) do {} while (0)
+#define PROFILE_LOOP_BEGIN() do {} while (0)
+#define PROFILE_LOOP_END() do {} while (0)
+
+#endif
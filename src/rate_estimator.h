@@ -0,0 +1,170 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+
+// Consumption rate as the slope of a sliding least-squares line through the
+// weight. Readings are averaged into BUCKET_MS buckets and the fit covers
+// the last N buckets.
+//
+// x is the bucket's position in the window (0 = oldest), so Σx and Σx² follow
+// from the bucket count and only Σy, Σy² and Σxy are kept. Sliding the window
+// is O(1): drop the oldest bucket, then renumber with Σxy -= Σy. Weights are
+// stored relative to a reference that is rebased on every resync, which keeps
+// the float sums small while a spool empties over hours.
+//
+// A bucket far off the current line is ignored unless MAX_CONSECUTIVE_REJECTS
+// follow in a row, in which case the weight really stepped (spool swapped,
+// something put on the scale) and the fit starts over.
+template <uint16_t N>
+class RateEstimator {
+public:
+    static constexpr uint32_t BUCKET_MS = 5000;
+    static constexpr uint16_t MIN_BUCKETS = 12;        // One minute before a rate is reported
+    static constexpr float REJECT_SIGMA = 4.0f;
+    static constexpr float MIN_REJECT_GRAMS = 0.5f;    // Never reject closer to the line than this
+    static constexpr uint8_t MAX_CONSECUTIVE_REJECTS = 3;
+    static constexpr uint16_t RESYNC_INTERVAL = 256;
+
+    RateEstimator() {
+        reset();
+    }
+
+    void reset() {
+        n = 0;
+        head = 0;
+        reference = 0.0f;
+        sumY = 0.0f;
+        sumYY = 0.0f;
+        sumXY = 0.0f;
+        rejects = 0;
+        additions = 0;
+        bucketStart = 0;
+        bucketSum = 0.0f;
+        bucketCount = 0;
+    }
+
+    // Feed one reading. Returns true when a bucket was completed and the fit changed.
+    bool push(uint32_t timestampMs, float grams) {
+        bool completed = false;
+        if (bucketCount > 0 && timestampMs - bucketStart >= BUCKET_MS) {
+            addBucket(bucketSum / bucketCount);
+            bucketCount = 0;
+            completed = true;
+        }
+        if (bucketCount == 0) {
+            bucketStart = timestampMs;
+            bucketSum = 0.0f;
+        }
+        bucketSum += grams;
+        bucketCount++;
+        return completed;
+    }
+
+    bool valid() const { return n >= MIN_BUCKETS; }
+    uint16_t count() const { return n; }
+
+    // Weight change per hour; negative while filament is being used
+    float gramsPerHour() const {
+        if (n < 2) return 0.0f;
+        return slope() * (3600000.0f / BUCKET_MS);
+    }
+
+private:
+    // Σ(x - x̄)² for x = 0..n-1
+    float varianceX() const {
+        return (float)n * ((float)n * n - 1.0f) / 12.0f;
+    }
+
+    float meanX() const {
+        return (n - 1) / 2.0f;
+    }
+
+    // Grams per bucket
+    float slope() const {
+        return (sumXY - meanX() * sumY) / varianceX();
+    }
+
+    float residualSigma() const {
+        if (n < 3) return 0.0f;
+        float centeredYY = sumYY - sumY * sumY / n;
+        float centeredXY = sumXY - meanX() * sumY;
+        float sse = centeredYY - slope() * centeredXY;
+        return sse > 0.0f ? sqrtf(sse / (n - 2)) : 0.0f;
+    }
+
+    void addBucket(float grams) {
+        if (n >= MIN_BUCKETS) {
+            float b = slope();
+            float predicted = (sumY / n - b * meanX()) + b * n + reference;
+            float limit = REJECT_SIGMA * residualSigma();
+            if (limit < MIN_REJECT_GRAMS) limit = MIN_REJECT_GRAMS;
+            if (fabsf(grams - predicted) > limit) {
+                if (++rejects <= MAX_CONSECUTIVE_REJECTS) return;
+                reset();
+            }
+        }
+        rejects = 0;
+
+        if (n == 0) reference = grams;
+        float y = grams - reference;
+
+        if (n == N) {
+            // Drop the oldest bucket (x = 0) and renumber the rest one lower
+            float old = window[head];
+            head = (head + 1) % N;
+            n--;
+            sumY -= old;
+            sumYY -= old * old;
+            sumXY -= sumY;
+        }
+
+        window[(head + n) % N] = y;
+        sumXY += (float)n * y;
+        sumY += y;
+        sumYY += y * y;
+        n++;
+
+        if (++additions >= RESYNC_INTERVAL) resync();
+    }
+
+    // Recompute the sums exactly, relative to the oldest bucket
+    void resync() {
+        additions = 0;
+        float rebase = window[head];
+        reference += rebase;
+        sumY = 0.0f;
+        sumYY = 0.0f;
+        sumXY = 0.0f;
+        for (uint16_t i = 0; i < n; i++) {
+            float& y = window[(head + i) % N];
+            y -= rebase;
+            sumY += y;
+            sumYY += y * y;
+            sumXY += (float)i * y;
+        }
+    }
+
+    float window[N];
+    uint16_t n;
+    uint16_t head;
+    float reference;
+    float sumY;
+    float sumYY;
+    float sumXY;
+    uint8_t rejects;
+    uint16_t additions;
+
+    // Bucket being averaged
+    uint32_t bucketStart;
+    float bucketSum;
+    uint32_t bucketCount;
+};
+
+// Seconds until `remaining` grams are used up at a rate of gramsPerHour
+// (negative while consuming). NAN while nothing is being used.
+inline float secondsToEmpty(float remaining, float gramsPerHour) {
+    static constexpr float MIN_CONSUMPTION = 1.0f;  // g/h; anything slower is drift
+    if (isnan(gramsPerHour) || -gramsPerHour < MIN_CONSUMPTION) return NAN;
+    if (remaining <= 0.0f) return 0.0f;
+    return remaining / -gramsPerHour * 3600.0f;
+}
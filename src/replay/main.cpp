@@ -0,0 +1,391 @@
+// Replays recorded HX711 traces through a scale channel's conversion and filters
+// (pio run -e replay).
+//
+// A trace is what "capture" on the serial console or startCapture() in the
+// browser console records: "# key=value" settings, then "timestamp_ms,raw"
+// lines. Anything else is skipped, so a serial log works as is. Each sample
+// goes through ScaleChannel::processSample() with the recorded settings, and every
+// step in the weight (a spool swapped, a vessel put down) is measured on the
+// filtered output:
+//   settle     until the filtered weight stays within the tolerance of the new level
+//   stable     until isStable() reports a weight within the tolerance of it
+//   overshoot  furthest the filtered weight went past the new level
+//   noise      standard deviation of the filtered and raw weight once settled
+//
+//   program [options] trace.csv...
+//     --outlier SIGMA, --median WINDOW, --ema ALPHA, --no-filter
+//                     replace the recorded filter settings
+//     --tolerance G   settling band in grams (default 0.5)
+//     --step G        smallest change in grams that counts as a step (default 5)
+//     --json FILE     also write the results as JSON
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "scale.h"
+#include "metrics.h"
+#include "profiler.h"
+
+SimLoadCell loadCells[HX711_CHIPS];
+Metrics metrics;
+#if PROFILER_ENABLED
+Profiler profiler;
+#endif
+
+struct Trace {
+    std::string path;
+    float factor;
+    float offset;
+    std::vector<CalibrationTable::Point> points;
+    FilterConfig filter;
+    std::vector<uint32_t> timestamps;
+    std::vector<int32_t> raw;
+};
+
+// One replayed sample, in grams
+struct Replayed {
+    uint32_t timestamp;
+    float raw;
+    float filtered;
+    bool stable;
+    float stableWeight;
+};
+
+// Samples [begin, end) sit at one weight
+struct Level {
+    size_t begin;
+    size_t end;
+    float grams;
+};
+
+struct Step {
+    float atSeconds;
+    float from;
+    float to;
+    int32_t settleMs;       // -1 if it never settled
+    int32_t stableMs;       // -1 if it was never reported stable
+    float overshoot;
+    float noise;
+    float rawNoise;
+};
+
+struct Options {
+    bool filterOverride = false;
+    FilterConfig filter = defaultFilterConfig();
+    float tolerance = 0.5f;
+    float stepGrams = 5.0f;
+    const char* jsonPath = nullptr;
+};
+
+// A new level needs this many consecutive readings that agree, and has to
+// last MIN_LEVEL_MS; anything shorter is part of the transition.
+static const size_t LEVEL_CONFIRM_SAMPLES = 3;
+static const uint32_t MIN_LEVEL_MS = 2000;
+
+static bool loadTrace(const char* path, Trace& trace) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    trace.path = path;
+    trace.factor = 1.0f;
+    trace.offset = 0.0f;
+    trace.filter = defaultFilterConfig();
+
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        float a, b;
+        unsigned long timestamp;
+        long raw;
+        int consumed = 0;
+        if (sscanf(line, "# factor=%f", &a) == 1) {
+            trace.factor = a;
+        } else if (sscanf(line, "# offset=%f", &a) == 1) {
+            trace.offset = a;
+        } else if (sscanf(line, "# point=%f,%f", &a, &b) == 2) {
+            trace.points.push_back({a, b});
+        } else if (sscanf(line, "# outlier=%f", &a) == 1) {
+            trace.filter.outlierEnabled = true;
+            trace.filter.outlierSigma = a;
+        } else if (sscanf(line, "# median=%f", &a) == 1) {
+            trace.filter.medianEnabled = true;
+            trace.filter.medianWindow = (uint8_t)a;
+        } else if (sscanf(line, "# ema=%f", &a) == 1) {
+            trace.filter.emaEnabled = true;
+            trace.filter.emaAlpha = a;
+        } else if (sscanf(line, "%lu,%ld%n", &timestamp, &raw, &consumed) == 2 &&
+                   strspn(line + consumed, " \r\n") == strlen(line + consumed)) {
+            trace.timestamps.push_back(timestamp);
+            trace.raw.push_back(raw);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static std::vector<Replayed> replay(const Trace& trace, const FilterConfig& filter) {
+    ScaleChannel* scale = new ScaleChannel();
+    scale->setCalibrationFactor(trace.factor);
+    scale->setOffset(trace.offset);
+    if (!trace.points.empty()) scale->loadCalibrationTable(trace.points.data(), trace.points.size());
+    scale->setFilterConfig(filter);
+
+    std::vector<Replayed> out;
+    out.reserve(trace.raw.size());
+    for (size_t i = 0; i < trace.raw.size(); i++) {
+        scale->processSample(trace.raw[i], trace.timestamps[i]);
+        out.push_back({trace.timestamps[i], scale->toWeight(trace.raw[i]), scale->getWeight(),
+                       scale->isStable(), scale->getStableWeight()});
+    }
+    delete scale;
+    return out;
+}
+
+static float median(std::vector<float> values) {
+    if (values.empty()) return NAN;
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+static float stddev(const std::vector<Replayed>& samples, size_t begin, size_t end, bool filtered) {
+    if (end - begin < 2) return NAN;
+    double sum = 0, sumSquares = 0;
+    for (size_t i = begin; i < end; i++) {
+        double x = filtered ? samples[i].filtered : samples[i].raw;
+        sum += x;
+        sumSquares += x * x;
+    }
+    double n = end - begin;
+    double variance = (sumSquares - sum * sum / n) / (n - 1);
+    return variance > 0 ? sqrt(variance) : 0.0f;
+}
+
+// Split the raw weight into levels. A level ends at the first reading that
+// leaves it; the next one starts with LEVEL_CONFIRM_SAMPLES readings in a row
+// that agree with each other, so single spikes and hands on the spool during
+// a swap don't start levels of their own.
+static std::vector<Level> findLevels(const std::vector<Replayed>& samples, float stepGrams) {
+    std::vector<Level> levels;
+    if (samples.empty()) return levels;
+
+    Level current = {0, 0, samples[0].raw};
+    float reference = samples[0].raw;
+    size_t departure = 0;
+    size_t offCount = 0;
+    for (size_t i = 1; i < samples.size(); i++) {
+        if (fabsf(samples[i].raw - reference) <= stepGrams) {
+            // Follow slow drift, e.g. filament being used
+            reference += 0.1f * (samples[i].raw - reference);
+            offCount = 0;
+            continue;
+        }
+        if (offCount++ == 0) departure = i;
+        if (offCount < LEVEL_CONFIRM_SAMPLES) continue;
+
+        size_t runStart = i + 1 - LEVEL_CONFIRM_SAMPLES;
+        float lo = samples[runStart].raw, hi = lo;
+        for (size_t j = runStart; j <= i; j++) {
+            lo = std::min(lo, samples[j].raw);
+            hi = std::max(hi, samples[j].raw);
+        }
+        if (hi - lo > stepGrams) continue;
+
+        current.end = departure;
+        levels.push_back(current);
+        current = {runStart, 0, 0.0f};
+        reference = (lo + hi) / 2;
+        offCount = 0;
+    }
+    current.end = samples.size();
+    levels.push_back(current);
+
+    // Drop levels too short to be anything but part of a transition
+    std::vector<Level> kept;
+    for (Level level : levels) {
+        if (level.end <= level.begin) continue;
+        if (samples[level.end - 1].timestamp - samples[level.begin].timestamp < MIN_LEVEL_MS) continue;
+        std::vector<float> values;
+        for (size_t i = level.begin; i < level.end; i++) values.push_back(samples[i].raw);
+        level.grams = median(values);
+        kept.push_back(level);
+    }
+    return kept;
+}
+
+static Step measureStep(const std::vector<Replayed>& samples, const Level& before, const Level& after, float tolerance) {
+    size_t start = before.end;
+    uint32_t t0 = samples[start].timestamp;
+    float target = after.grams;
+    float direction = target > before.grams ? 1.0f : -1.0f;
+
+    Step step;
+    step.atSeconds = (t0 - samples[0].timestamp) / 1000.0f;
+    step.from = before.grams;
+    step.to = target;
+    step.overshoot = 0.0f;
+    step.stableMs = -1;
+
+    size_t settled = start;
+    for (size_t i = start; i < after.end; i++) {
+        float error = samples[i].filtered - target;
+        step.overshoot = std::max(step.overshoot, error * direction);
+        if (fabsf(error) > tolerance) settled = i + 1;
+        if (step.stableMs < 0 && samples[i].stable && fabsf(samples[i].stableWeight - target) <= tolerance) {
+            step.stableMs = samples[i].timestamp - t0;
+        }
+    }
+
+    // Noise over the settled part, or the second half of the level if it never settled
+    size_t noiseStart = settled;
+    if (settled < after.end) {
+        step.settleMs = samples[settled].timestamp - t0;
+    } else {
+        step.settleMs = -1;
+        noiseStart = after.begin + (after.end - after.begin) / 2;
+    }
+    step.noise = stddev(samples, noiseStart, after.end, true);
+    step.rawNoise = stddev(samples, noiseStart, after.end, false);
+    return step;
+}
+
+static void describeFilter(const FilterConfig& filter, char* out, size_t size) {
+    int n = snprintf(out, size, "%s", "");
+    if (filter.outlierEnabled) n += snprintf(out + n, size - n, " outlier=%.2f", filter.outlierSigma);
+    if (filter.medianEnabled) n += snprintf(out + n, size - n, " median=%u", filter.medianWindow);
+    if (filter.emaEnabled) n += snprintf(out + n, size - n, " ema=%.3f", filter.emaAlpha);
+    if (n == 0) snprintf(out, size, " none");
+}
+
+static void printMs(int32_t ms) {
+    if (ms < 0) {
+        Serial.printf(" %12s", "never");
+    } else {
+        Serial.printf(" %12ld", (long)ms);
+    }
+}
+
+static void usage() {
+    Serial.println("usage: program [--outlier SIGMA] [--median WINDOW] [--ema ALPHA] [--no-filter]\n"
+                   "               [--tolerance G] [--step G] [--json FILE] trace.csv...");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--no-filter") {
+            options.filterOverride = true;
+        } else if (arg == "--outlier" && hasValue) {
+            options.filterOverride = true;
+            options.filter.outlierEnabled = true;
+            options.filter.outlierSigma = atof(argv[++i]);
+        } else if (arg == "--median" && hasValue) {
+            options.filterOverride = true;
+            options.filter.medianEnabled = true;
+            options.filter.medianWindow = atoi(argv[++i]);
+        } else if (arg == "--ema" && hasValue) {
+            options.filterOverride = true;
+            options.filter.emaEnabled = true;
+            options.filter.emaAlpha = atof(argv[++i]);
+        } else if (arg == "--tolerance" && hasValue) {
+            options.tolerance = atof(argv[++i]);
+        } else if (arg == "--step" && hasValue) {
+            options.stepGrams = atof(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 2;
+    }
+
+    FILE* json = options.jsonPath ? fopen(options.jsonPath, "w") : nullptr;
+    if (options.jsonPath && !json) {
+        Serial.printf("Failed to write %s\n", options.jsonPath);
+        return 1;
+    }
+    if (json) fprintf(json, "{\"tolerance_g\":%g,\"traces\":[", options.tolerance);
+
+    std::vector<Step> allSteps;
+    int failed = 0;
+    unsigned written = 0;   // Traces in the JSON file so far
+    for (size_t t = 0; t < paths.size(); t++) {
+        Trace trace;
+        if (!loadTrace(paths[t], trace) || trace.raw.empty()) {
+            Serial.printf("%s: no samples\n", paths[t]);
+            failed++;
+            continue;
+        }
+        FilterConfig filter = options.filterOverride ? options.filter : trace.filter;
+        std::vector<Replayed> samples = replay(trace, filter);
+        std::vector<Level> levels = findLevels(samples, options.stepGrams);
+
+        std::vector<Step> steps;
+        for (size_t i = 1; i < levels.size(); i++) {
+            if (fabsf(levels[i].grams - levels[i - 1].grams) < options.stepGrams) continue;
+            steps.push_back(measureStep(samples, levels[i - 1], levels[i], options.tolerance));
+        }
+
+        char filterText[64];
+        describeFilter(filter, filterText, sizeof(filterText));
+        float duration = (samples.back().timestamp - samples.front().timestamp) / 1000.0f;
+        Serial.printf("%s: %u samples over %.1f s, %u steps, filter%s\n", paths[t], (unsigned)samples.size(),
+                      duration, (unsigned)steps.size(), filterText);
+        if (!steps.empty()) {
+            Serial.printf("  %4s %8s %10s %10s %12s %12s %10s %9s %9s\n", "step", "at s", "from g", "to g",
+                          "settle ms", "stable ms", "over g", "noise g", "raw g");
+        }
+        for (size_t i = 0; i < steps.size(); i++) {
+            const Step& s = steps[i];
+            Serial.printf("  %4u %8.1f %10.1f %10.1f", (unsigned)(i + 1), s.atSeconds, s.from, s.to);
+            printMs(s.settleMs);
+            printMs(s.stableMs);
+            Serial.printf(" %10.2f %9.3f %9.3f\n", s.overshoot, s.noise, s.rawNoise);
+        }
+
+        if (json) {
+            fprintf(json, "%s\n{\"file\":\"%s\",\"samples\":%u,\"duration_s\":%.1f,\"filter\":\"%s\",\"steps\":[",
+                    written++ ? "," : "", trace.path.c_str(), (unsigned)samples.size(), duration, filterText + 1);
+            for (size_t i = 0; i < steps.size(); i++) {
+                const Step& s = steps[i];
+                fprintf(json, "%s{\"at_s\":%.2f,\"from_g\":%.2f,\"to_g\":%.2f,\"settle_ms\":%ld,\"stable_ms\":%ld,"
+                        "\"overshoot_g\":%.3f,\"noise_g\":%.4f,\"raw_noise_g\":%.4f}",
+                        i ? "," : "", s.atSeconds, s.from, s.to, (long)s.settleMs, (long)s.stableMs,
+                        s.overshoot, isnan(s.noise) ? 0.0f : s.noise, isnan(s.rawNoise) ? 0.0f : s.rawNoise);
+            }
+            fprintf(json, "]}");
+        }
+        allSteps.insert(allSteps.end(), steps.begin(), steps.end());
+    }
+    if (json) {
+        fprintf(json, "\n]}\n");
+        fclose(json);
+    }
+
+    // Across every trace: how the filters did on the whole library
+    if (paths.size() > 1 && !allSteps.empty()) {
+        std::vector<float> settle, stable, noise;
+        unsigned unsettled = 0, neverStable = 0;
+        float overshoot = 0.0f;
+        for (const Step& s : allSteps) {
+            if (s.settleMs < 0) unsettled++; else settle.push_back(s.settleMs);
+            if (s.stableMs < 0) neverStable++; else stable.push_back(s.stableMs);
+            if (!isnan(s.noise)) noise.push_back(s.noise);
+            overshoot = std::max(overshoot, s.overshoot);
+        }
+        Serial.printf("\n%u steps: settle median %.0f ms (%u never), stable median %.0f ms (%u never), "
+                      "max overshoot %.2f g, median noise %.3f g\n",
+                      (unsigned)allSteps.size(), median(settle), unsettled, median(stable), neverStable,
+                      overshoot, median(noise));
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// One HX711 conversion as captured by the sampling task
+struct Sample {
+    uint32_t seq;        // Monotonic sample number, first sample is 1
+    uint32_t timestamp;  // millis() when the conversion was read
+    int32_t raw;         // Signed 24-bit ADC counts
+    float filtered;      // Counts after the Scale filter chain, offset not removed
+};
+
+// Fixed-size single-producer/multi-consumer ring of samples.
+// The producer fills a slot and publishes its sequence number last; readers
+// copy the slot and re-check the sequence number, so a slot that was
+// overwritten mid-copy is reported as missing instead of returning torn data.
+template <size_t N>
+class SampleRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+public:
+    SampleRing() : head(0) {
+        for (size_t i = 0; i < N; i++) {
+            slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side: only the sampling task may call this
+    void push(int32_t raw, float filtered, uint32_t timestamp) {
+        uint32_t seq = head.load(std::memory_order_relaxed) + 1;
+        if (seq == 0) seq = 1;  // 0 marks an empty or in-flight slot
+
+        Slot& slot = slots[seq & (N - 1)];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.raw.store(raw, std::memory_order_relaxed);
+        slot.filtered.store(filtered, std::memory_order_relaxed);
+        slot.timestamp.store(timestamp, std::memory_order_relaxed);
+        slot.seq.store(seq, std::memory_order_release);
+        head.store(seq, std::memory_order_release);
+    }
+
+    // Sequence number of the newest published sample, 0 if none yet
+    uint32_t headSeq() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Copy the sample with the given sequence number.
+    // Returns false if it was never written or has already been overwritten.
+    bool read(uint32_t seq, Sample& out) const {
+        if (seq == 0) return false;
+        const Slot& slot = slots[seq & (N - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != seq) return false;
+        out.raw = slot.raw.load(std::memory_order_relaxed);
+        out.filtered = slot.filtered.load(std::memory_order_relaxed);
+        out.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) return false;
+        out.seq = seq;
+        return true;
+    }
+
+    bool latest(Sample& out) const {
+        // The newest slot can only be overwritten after N more pushes,
+        // so a couple of retries is plenty
+        for (int attempt = 0; attempt < 3; attempt++) {
+            if (read(headSeq(), out)) return true;
+        }
+        return false;
+    }
+
+    // Copy up to count of the most recent samples into out, oldest first.
+    // Returns the number of samples copied.
+    size_t copyLatest(Sample* out, size_t count) const {
+        if (count > N - 1) count = N - 1;  // Leave one slot of slack for the producer
+        uint32_t newest = headSeq();
+        if (count > newest) count = newest;
+
+        size_t copied = 0;
+        for (uint32_t seq = newest - count + 1; copied < count; seq++) {
+            if (read(seq, out[copied])) {
+                copied++;
+            } else if (copied == 0) {
+                count--;  // Oldest requested sample already overwritten, skip it
+            } else {
+                break;
+            }
+        }
+        return copied;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> timestamp;
+        std::atomic<int32_t> raw;
+        std::atomic<float> filtered;
+    };
+
+    Slot slots[N];
+    std::atomic<uint32_t> head;
+};
@@ -1,49 +1,156 @@
 #pragma once
-#include <HX711.h>
+#include <Arduino.h>
+#include <math.h>
 #include "config.h"
+#include "calibration_table.h"
+#include "hx711_driver.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "rate_estimator.h"
+#include "sample_ring.h"
+#include "weight_filter.h"
 
-class Scale {
+// The HX711s on their GPIO pins, or the simulated load cells in the native build
+#ifdef ARDUINO
+typedef ArduinoHx711Io ScaleIo;
+inline ScaleIo makeScaleIo() { return ArduinoHx711Io(HX711_DATA_PIN_LIST, HX711_CHIPS, HX711_CLOCK_PIN); }
+#else
+#include <sim_load_cell.h>
+typedef SimLoadCellIo ScaleIo;
+inline ScaleIo makeScaleIo() { return SimLoadCellIo(loadCells, HX711_CHIPS); }
+#endif
+
+static_assert(HX711_CHIPS >= 1 && HX711_CHIPS <= HX711_MAX_LANES, "HX711_DATA_PINS lists 1 to 8 pins");
+
+// Conversion, filtering, stability and rate estimation for one load cell,
+// with its own calibration and tare. The Scale's sampling task feeds it;
+// everything else reads the sample ring.
+class ScaleChannel {
 public:
-    Scale() : calibrationFactor(1.0f), offset(0.0f), calibrationMargin(0.02f) {}
-    
-    void init() {
-        scale.begin(HX711_DATA_PIN, HX711_CLOCK_PIN);
-        scale.set_scale(calibrationFactor);
-        scale.set_offset(offset);
+    static constexpr size_t SAMPLE_BUFFER_SIZE = 64;
+    static constexpr size_t TARE_SAMPLES = 10;
+
+    ScaleChannel()
+        : calibrationFactor(1.0f), gramsPerCount(1.0f), countsPerGram(1.0f),
+          stabilityLimit(STABILITY_RAW_THRESHOLD), offset(0.0f), calibrationMargin(0.02f),
+          pendingFilterConfig(defaultFilterConfig()), filterConfigChanged(false),
+          stable(false), stableCounts(0.0f), rateResetRequested(false), consumptionRate(NAN) {
+        filterMux = portMUX_INITIALIZER_UNLOCKED;
+        tableMux = portMUX_INITIALIZER_UNLOCKED;
+    }
+
+    float getWeight() const {
+        Sample sample;
+        if (!samples.latest(sample)) return 0.0f;
+        return toWeight(sample.filtered);
+    }
+
+    // Convert filtered counts (offset not removed) to grams
+    float toWeight(float counts) const {
+        float tared = counts - offset;
+        portENTER_CRITICAL(&tableMux);
+        if (!table.isEmpty()) {
+            float grams = table.apply(tared);
+            portEXIT_CRITICAL(&tableMux);
+            return grams;
+        }
+        portEXIT_CRITICAL(&tableMux);
+        return tared * gramsPerCount;
+    }
+
+    float getRawValue() const {
+        // Latest raw reading with the tare offset removed
+        Sample sample;
+        if (!samples.latest(sample)) return 0.0f;
+        return sample.raw - offset;
+    }
+
+    // Average of the most recent raw readings (offset not removed)
+    float getAverageRaw(size_t count) const {
+        Sample window[SAMPLE_BUFFER_SIZE];
+        if (count > SAMPLE_BUFFER_SIZE) count = SAMPLE_BUFFER_SIZE;
+        size_t n = samples.copyLatest(window, count);
+        if (n == 0) return offset;
+
+        int64_t sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            sum += window[i].raw;
+        }
+        return (float)sum / n;
+    }
+
+    // Block the caller until the sampling task has produced count more samples
+    bool waitForSamples(uint32_t count, uint32_t timeoutMs) {
+        uint32_t target = samples.headSeq() + count;
+        unsigned long start = millis();
+        while ((int32_t)(samples.headSeq() - target) < 0) {
+            if (millis() - start > timeoutMs) return false;
+            delay(10);
+        }
+        return true;
+    }
+
+    // True while the last STABILITY_WINDOW filtered readings agree within STABILITY_THRESHOLD grams
+    // (STABILITY_RAW_THRESHOLD counts before the channel is calibrated)
+    bool isStable() const {
+        return stable.load(std::memory_order_acquire);
+    }
+
+    // Mean of the stability window in grams; only meaningful while isStable()
+    float getStableWeight() const {
+        return toWeight(stableCounts.load(std::memory_order_relaxed));
     }
-    
-    float getWeight() {
-        return scale.get_units();
+
+    // Wait for the first settled reading. On timeout weight gets the latest
+    // filtered reading and false is returned.
+    bool waitForStable(uint32_t timeoutMs, float& weight) {
+        unsigned long start = millis();
+        while (!isStable()) {
+            if (millis() - start > timeoutMs) {
+                weight = getWeight();
+                return false;
+            }
+            delay(10);
+        }
+        weight = getStableWeight();
+        return true;
     }
 
-    float getRawValue() {
-        // Get raw reading and subtract offset
-        float raw = scale.read_average(1);  // Use 1 reading to avoid crashes
-        float offset = scale.get_offset();
-        return raw - offset;
+    // Weight change in grams per hour over the last RATE_WINDOW_BUCKETS buckets,
+    // negative while filament is used. NAN until enough readings are in.
+    float getConsumptionRate() const {
+        return consumptionRate.load(std::memory_order_relaxed);
     }
-    
-    void tare() {
-        scale.tare();
-        offset = scale.get_offset();
+
+    const SampleRing<SAMPLE_BUFFER_SIZE>& getSamples() const {
+        return samples;
     }
-    
+
+    bool tare() {
+        if (samples.headSeq() == 0) return false;
+        // Prefer the settled window mean; fall back to the recent raw average
+        offset = isStable() ? stableCounts.load(std::memory_order_relaxed) : getAverageRaw(TARE_SAMPLES);
+        resetRate();
+        return true;
+    }
+
     void setCalibrationFactor(float factor) {
         calibrationFactor = factor;
-        scale.set_scale(calibrationFactor);
+        gramsPerCount = 1.0f / factor;
+        updateSensitivity();
     }
-    
+
     float getCalibrationFactor() const {
         return calibrationFactor;
     }
-    
+
     float getOffset() const {
         return offset;
     }
-    
+
     void setOffset(float newOffset) {
         offset = newOffset;
-        scale.set_offset(offset);
+        resetRate();
     }
 
     void setCalibrationMargin(float margin) {
@@ -54,9 +161,244 @@ public:
         return calibrationMargin;
     }
 
+    // Multi-point calibration; while the table has points it replaces calibrationFactor
+    bool addCalibrationPoint(float counts, float grams) {
+        portENTER_CRITICAL(&tableMux);
+        bool added = table.addPoint(counts, grams);
+        portEXIT_CRITICAL(&tableMux);
+        updateSensitivity();
+        return added;
+    }
+
+    bool loadCalibrationTable(const CalibrationTable::Point* points, uint8_t count) {
+        portENTER_CRITICAL(&tableMux);
+        bool loaded = table.load(points, count);
+        portEXIT_CRITICAL(&tableMux);
+        updateSensitivity();
+        return loaded;
+    }
+
+    void clearCalibrationPoints() {
+        portENTER_CRITICAL(&tableMux);
+        table.clear();
+        portEXIT_CRITICAL(&tableMux);
+        updateSensitivity();
+    }
+
+    CalibrationTable getCalibrationTable() const {
+        portENTER_CRITICAL(&tableMux);
+        CalibrationTable copy = table;
+        portEXIT_CRITICAL(&tableMux);
+        return copy;
+    }
+
+    // Takes effect on the sampling task at the next conversion
+    void setFilterConfig(const FilterConfig& config) {
+        portENTER_CRITICAL(&filterMux);
+        pendingFilterConfig = config;
+        portEXIT_CRITICAL(&filterMux);
+        filterConfigChanged.store(true, std::memory_order_release);
+    }
+
+    FilterConfig getFilterConfig() {
+        portENTER_CRITICAL(&filterMux);
+        FilterConfig config = pendingFilterConfig;
+        portEXIT_CRITICAL(&filterMux);
+        return config;
+    }
+
+    // Filtering, stability and rate estimation for one conversion. Runs on the
+    // sampling task; a host replay calls it directly on a channel of its own,
+    // so recorded traces go through exactly this code.
+    void processSample(int32_t raw, uint32_t timestamp) {
+        if (filterConfigChanged.exchange(false, std::memory_order_acquire)) {
+            portENTER_CRITICAL(&filterMux);
+            FilterConfig config = pendingFilterConfig;
+            portEXIT_CRITICAL(&filterMux);
+            filters.configure(config);
+        }
+        float filtered = filters.process(raw);
+        updateStability(filtered);
+        updateRate(filtered, timestamp);
+        samples.push(raw, filtered, timestamp);
+    }
+
 private:
-    HX711 scale;
-    float calibrationFactor;
-    float offset;
+    // The weight scale changed under the estimator; the sampling task starts a new fit
+    void resetRate() {
+        consumptionRate.store(NAN, std::memory_order_relaxed);
+        rateResetRequested.store(true, std::memory_order_release);
+    }
+
+    void updateSensitivity() {
+        portENTER_CRITICAL(&tableMux);
+        bool calibrated = !table.isEmpty() || calibrationFactor != 1.0f;
+        countsPerGram = table.isEmpty() ? calibrationFactor : table.countsPerGram();
+        portEXIT_CRITICAL(&tableMux);
+        stabilityLimit = calibrated ? STABILITY_THRESHOLD * fabsf(countsPerGram) : STABILITY_RAW_THRESHOLD;
+        resetRate();
+    }
+
+    void updateStability(float filtered) {
+        stability.push(filtered);
+        float limit = stabilityLimit;
+        bool settled = stability.full() && stability.variance() <= limit * limit;
+        stableCounts.store(stability.mean(), std::memory_order_relaxed);
+        stable.store(settled, std::memory_order_release);
+    }
+
+    void updateRate(float filtered, uint32_t timestamp) {
+        if (rateResetRequested.exchange(false, std::memory_order_acquire)) {
+            rate.reset();
+        }
+        if (rate.push(timestamp, toWeight(filtered))) {
+            consumptionRate.store(rate.valid() ? rate.gramsPerHour() : NAN, std::memory_order_relaxed);
+        }
+    }
+
+    SampleRing<SAMPLE_BUFFER_SIZE> samples;
+    volatile float calibrationFactor;
+    volatile float gramsPerCount;   // 1 / calibrationFactor, keeps the division off the read path
+    volatile float countsPerGram;   // Sensitivity of whichever conversion is active
+    volatile float stabilityLimit;  // Standard deviation in counts below which the reading is settled
+    CalibrationTable table;
+    mutable portMUX_TYPE tableMux;
+    volatile float offset;
     float calibrationMargin;
+
+    // Owned by the sampling task; other tasks hand over changes through pendingFilterConfig
+    FilterChain filters;
+    FilterConfig pendingFilterConfig;
+    std::atomic<bool> filterConfigChanged;
+    portMUX_TYPE filterMux;
+
+    RollingStats<STABILITY_WINDOW> stability;
+    std::atomic<bool> stable;
+    std::atomic<float> stableCounts;
+
+    // Owned by the sampling task
+    RateEstimator<RATE_WINDOW_BUCKETS> rate;
+    std::atomic<bool> rateResetRequested;
+    std::atomic<float> consumptionRate;
+};
+
+// Every load cell on the HX711s that share HX711_CLOCK_PIN. One sampling task
+// clocks all chips in lockstep, a single SCK pulse train for every DOUT line,
+// and hands each chip's conversion to its channel. With HX711_INPUT_B the
+// chips alternate between their two inputs; with the settling reads dropped
+// each channel gets a quarter of the chip's conversions.
+class Scale {
+public:
+    static constexpr uint8_t INPUTS = HX711_INPUT_B ? 2 : 1;
+    // Conversions read from one input before switching to the other. The
+    // first INPUT_SETTLE_READS after a switch are dropped while the chip's
+    // filter settles (400 ms at 10 SPS per the datasheet).
+    static constexpr uint8_t INPUT_DWELL_READS = 8;
+    static constexpr uint8_t INPUT_SETTLE_READS = 4;
+    // Chip conversions per sample a channel gets
+    static constexpr uint32_t RATE_DIVIDER =
+        INPUTS > 1 ? INPUTS * INPUT_DWELL_READS / (INPUT_DWELL_READS - INPUT_SETTLE_READS) : 1;
+    // STABILITY_TIMEOUT_MS stretched to the channel sample rate, so a wait
+    // for a settled reading sees as many samples on every build
+    static constexpr uint32_t STABILITY_TIMEOUT = STABILITY_TIMEOUT_MS * RATE_DIVIDER;
+
+    Scale() : adc(makeScaleIo()), samplingTask(nullptr), faultedChips(0), input(0), inputReads(0) {}
+
+    void init() {
+        adc.begin();
+
+        // All ADC reads happen on the sampling task; everything else reads the ring buffers
+        xTaskCreate(samplingTaskEntry, "hx711", SAMPLING_TASK_STACK, this,
+                    SAMPLING_TASK_PRIORITY, &samplingTask);
+    }
+
+    // Channel of input A of chip n is n * INPUTS, input B the one after
+    ScaleChannel& channel(uint8_t index) {
+        return channels[index];
+    }
+
+    uint8_t channelCount() const {
+        return SCALE_CHANNELS;
+    }
+
+    // True while the channel's chip has stopped delivering conversions; its
+    // readings are stale until it recovers
+    bool isFaulted(uint8_t index) const {
+        return (faultedChips.load(std::memory_order_relaxed) >> (index / INPUTS)) & 1u;
+    }
+
+private:
+    static constexpr uint32_t SAMPLING_TASK_STACK = 3072;
+    static constexpr UBaseType_t SAMPLING_TASK_PRIORITY = 2;
+    // Longest wait for every chip's data-ready edge before DOUT is polled again (10 SPS is 100 ms)
+    static constexpr uint32_t READY_TIMEOUT_MS = 250;
+
+    static void samplingTaskEntry(void* arg) {
+        static_cast<Scale*>(arg)->samplingLoop();
+    }
+
+    static void IRAM_ATTR onDataReady(void* arg) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(static_cast<Scale*>(arg)->samplingTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    void samplingLoop() {
+        // The task can start before xTaskCreate() has stored the handle
+        samplingTask = xTaskGetCurrentTaskHandle();
+        adc.attachReadyInterrupt(onDataReady, this);
+        for (;;) {
+            if (!adc.isReady()) {
+                // Sleep until DOUT falls instead of polling the pins
+                if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(READY_TIMEOUT_MS)) == 0) {
+                    metrics.samplesMissed.inc();
+                    // A chip that stays busy is masked out so the others keep sampling
+                    adc.noteReadyTimeout();
+                    faultedChips.store(adc.faultedLanes(), std::memory_order_relaxed);
+                }
+                continue;
+            }
+            // The words clocked out now were converted from `input`; the gain
+            // pulses after them pick the input of the next conversion
+            uint8_t readInput = input;
+            bool settled = INPUTS == 1 || inputReads >= INPUT_SETTLE_READS;
+            if (INPUTS > 1 && ++inputReads >= INPUT_DWELL_READS) {
+                input = (input + 1) % INPUTS;
+                inputReads = 0;
+                adc.setGain(input == 0 ? Hx711Driver<ScaleIo>::GAIN_A128 : Hx711Driver<ScaleIo>::GAIN_B32);
+            }
+
+            uint32_t readStart = micros();
+            int32_t raw[HX711_MAX_LANES];
+            {
+                PROFILE_SECTION(PROFILE_HX711_READ);
+                adc.disableReadyInterrupt();
+                adc.readWords(raw);
+                adc.enableReadyInterrupt();
+            }
+            metrics.readLatency.observe(micros() - readStart);
+            uint32_t faults = adc.faultedLanes();
+            faultedChips.store(faults, std::memory_order_relaxed);
+            metrics.samplesTaken.inc(HX711_CHIPS - __builtin_popcount(faults));
+            // Safety net for an edge that got in before the mask; a conversion that
+            // finished during the readout is caught by isReady() above
+            ulTaskNotifyTake(pdTRUE, 0);
+
+            if (!settled) continue;
+            uint32_t now = millis();
+            for (uint8_t chip = 0; chip < HX711_CHIPS; chip++) {
+                if (faults & (1u << chip)) continue;
+                channels[chip * INPUTS + readInput].processSample(raw[chip], now);
+            }
+        }
+    }
+
+    Hx711Driver<ScaleIo> adc;
+    ScaleChannel channels[SCALE_CHANNELS];
+    TaskHandle_t samplingTask;
+    std::atomic<uint32_t> faultedChips;  // Lanes the driver has masked out, one bit per chip
+
+    // Owned by the sampling task
+    uint8_t input;          // Input the pending conversions come from, 0 = A, 1 = B
+    uint8_t inputReads;     // Conversions read since switching to it
 };
@@ -0,0 +1,227 @@
+#pragma once
+#include <stdint.h>
+
+// Host-side model of the HX711 DOUT/SCK interface.
+//
+// Time is virtual and only moves when advance() is called, so a driver can be
+// stepped through conversions deterministically. The model follows the
+// datasheet behaviour the driver depends on:
+//   - DOUT falls when a conversion is ready and stays low until it is read
+//   - each SCK rising edge shifts the next bit (MSB first) onto DOUT
+//   - pulses 25..27 select gain/channel for the next conversion and release DOUT
+//   - SCK held high for more than 60us powers the chip down
+// Protocol violations are counted rather than asserted so callers can check them.
+class SimHx711 {
+public:
+    static constexpr uint32_t POWER_DOWN_US = 60;
+    static constexpr uint32_t PERIOD_10SPS_US = 100000;
+    static constexpr uint32_t PERIOD_80SPS_US = 12500;
+
+    typedef int32_t (*ValueSource)(uint64_t timeUs, uint8_t gainPulses, void* arg);
+    typedef void (*EdgeCallback)(void* arg);
+
+    struct Stats {
+        uint32_t conversions;     // Conversions completed
+        uint32_t wordsRead;       // Words clocked out completely (24 bits + gain pulses)
+        uint32_t overwritten;     // Conversions replaced before they were read
+        uint32_t truncatedReads;  // Conversions that landed in the middle of a readout
+        uint32_t powerDowns;      // SCK held high for longer than POWER_DOWN_US
+        uint32_t extraPulses;     // SCK pulses beyond the 27th or with no conversion pending
+        uint32_t maxSckHighUs;    // Longest observed SCK high phase
+    };
+
+    explicit SimHx711(uint32_t conversionPeriodUs = PERIOD_10SPS_US)
+        : period(conversionPeriodUs), nowUs(0), nextConversionUs(conversionPeriodUs),
+          sck(false), sckHighSinceUs(0), doutLevel(true), ready(false), pulses(0),
+          word(0), gainPulses(1), constantValue(0), source(nullptr), sourceArg(nullptr),
+          edgeCallback(nullptr), edgeArg(nullptr), edgesEnabled(true), stats() {}
+
+    // Fixed value for every following conversion
+    void setValue(int32_t counts) {
+        constantValue = counts;
+        source = nullptr;
+    }
+
+    // Scriptable value for every following conversion
+    void setValueSource(ValueSource fn, void* arg) {
+        source = fn;
+        sourceArg = arg;
+    }
+
+    // Equivalent of the driver's FALLING interrupt on DOUT
+    void onFallingEdge(EdgeCallback cb, void* arg) {
+        edgeCallback = cb;
+        edgeArg = arg;
+    }
+
+    // Masks the callback like a disabled GPIO interrupt; edges meanwhile are lost
+    void setFallingEdgeEnabled(bool enabled) {
+        edgesEnabled = enabled;
+    }
+
+    void advance(uint64_t us) {
+        uint64_t target = nowUs + us;
+        while (nextConversionUs <= target) {
+            nowUs = nextConversionUs;
+            checkPowerDown();
+            completeConversion();
+            nextConversionUs += period;
+        }
+        nowUs = target;
+        checkPowerDown();
+    }
+
+    bool dout() const {
+        return doutLevel;
+    }
+
+    void setSck(bool high) {
+        if (high == sck) return;
+        sck = high;
+        if (high) {
+            sckHighSinceUs = nowUs;
+            risingEdge();
+        } else {
+            uint32_t highUs = (uint32_t)(nowUs - sckHighSinceUs);
+            if (highUs > stats.maxSckHighUs) stats.maxSckHighUs = highUs;
+            checkPowerDown();
+        }
+    }
+
+    uint64_t now() const {
+        return nowUs;
+    }
+
+    uint64_t nextConversionAt() const {
+        return nextConversionUs;
+    }
+
+    uint8_t getGainPulses() const {
+        return gainPulses;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+private:
+    void completeConversion() {
+        stats.conversions++;
+        if (pulses > 0 && pulses < 25) {
+            // Conversion finished while the previous word was half read
+            stats.truncatedReads++;
+            return;
+        }
+        if (ready && pulses == 0) {
+            stats.overwritten++;
+        }
+
+        int32_t value = source ? source(nowUs, gainPulses, sourceArg) : constantValue;
+        if (value > 0x7FFFFF) value = 0x7FFFFF;
+        if (value < -0x800000) value = -0x800000;
+        word = (uint32_t)value & 0xFFFFFF;
+        ready = true;
+        pulses = 0;
+        setDout(false);
+    }
+
+    void risingEdge() {
+        if (!ready) {
+            stats.extraPulses++;
+            return;
+        }
+        pulses++;
+        if (pulses <= 24) {
+            setDout((word >> (24 - pulses)) & 1);
+        } else if (pulses <= 27) {
+            gainPulses = pulses - 24;
+            setDout(true);
+            if (pulses == 25) stats.wordsRead++;
+        } else {
+            stats.extraPulses++;
+        }
+    }
+
+    void checkPowerDown() {
+        if (!sck || nowUs - sckHighSinceUs <= POWER_DOWN_US) return;
+        // Chip resets; the first conversion after wake-up follows a full period
+        stats.powerDowns++;
+        sckHighSinceUs = nowUs;
+        ready = false;
+        pulses = 0;
+        gainPulses = 1;
+        setDout(true);
+        nextConversionUs = nowUs + period;
+    }
+
+    void setDout(bool level) {
+        bool falling = doutLevel && !level;
+        doutLevel = level;
+        if (falling && edgesEnabled && edgeCallback) edgeCallback(edgeArg);
+    }
+
+    uint32_t period;
+    uint64_t nowUs;
+    uint64_t nextConversionUs;
+    bool sck;
+    uint64_t sckHighSinceUs;
+    bool doutLevel;
+    bool ready;
+    uint8_t pulses;
+    uint32_t word;
+    uint8_t gainPulses;
+    int32_t constantValue;
+    ValueSource source;
+    void* sourceArg;
+    EdgeCallback edgeCallback;
+    void* edgeArg;
+    bool edgesEnabled;
+    Stats stats;
+};
+
+// Single-lane Hx711Driver Io policy backed by a SimHx711; every SCK phase costs virtual time
+class SimHx711Io {
+public:
+    explicit SimHx711Io(SimHx711& chip, uint32_t halfPulseUs = 1) : chip(&chip), halfPulseUs(halfPulseUs) {}
+
+    void begin() {
+        chip->setSck(false);
+    }
+
+    uint8_t lanes() const {
+        return 1;
+    }
+
+    uint32_t readDout() {
+        return chip->dout() ? 1 : 0;
+    }
+
+    uint32_t clockBit() {
+        chip->setSck(true);
+        chip->advance(halfPulseUs);
+        bool bit = chip->dout();
+        chip->setSck(false);
+        chip->advance(halfPulseUs);
+        return bit ? 1 : 0;
+    }
+
+    void attachReadyInterrupt(void (*isr)(void*), void* arg) {
+        chip->onFallingEdge(isr, arg);
+    }
+
+    void detachReadyInterrupt() {
+        chip->onFallingEdge(nullptr, nullptr);
+    }
+
+    void disableReadyInterrupt() {
+        chip->setFallingEdgeEnabled(false);
+    }
+
+    void enableReadyInterrupt() {
+        chip->setFallingEdgeEnabled(true);
+    }
+
+private:
+    SimHx711* chip;
+    uint32_t halfPulseUs;
+};
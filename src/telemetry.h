@@ -0,0 +1,121 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact binary telemetry frame, opt-in per WebSocket client with
+// {"command": "setFormat", "format": "binary"}. JSON stays the default.
+//
+// Layout, all fields little-endian:
+//   offset size field
+//   0      1    magic            TELEMETRY_MAGIC ('T')
+//   1      1    version          TELEMETRY_VERSION
+//   2      2    flags            TELEMETRY_FLAG_*
+//   4      4    seq              sample sequence number
+//   8      4    timestamp        millis() when the sample was read
+//   12     4    raw              signed ADC counts before tare offset
+//   16     4    weight           total weight in milligrams
+//   20     4    filament         filament weight in milligrams (0 without vessel)
+//   24     2    selectedVessel   vessel id, -1 if none
+//   26     4    rate             weight change in milligrams per hour,
+//                                TELEMETRY_RATE_UNKNOWN until estimated
+//   30     4    eta              seconds until the vessel is empty,
+//                                TELEMETRY_ETA_UNKNOWN without vessel or consumption
+//   34     1    channel          load cell the frame is about
+//
+// With several load cells every channel gets frames of its own; seq,
+// timestamp and raw are that channel's.
+#define TELEMETRY_MAGIC     0x54
+#define TELEMETRY_VERSION   3
+#define TELEMETRY_FRAME_SIZE 35
+
+#define TELEMETRY_RATE_UNKNOWN  INT32_MIN
+#define TELEMETRY_ETA_UNKNOWN   UINT32_MAX
+
+#define TELEMETRY_FLAG_STABLE   0x0001
+#define TELEMETRY_FLAG_VESSEL   0x0002
+
+struct TelemetrySnapshot {
+    uint32_t seq;
+    uint32_t timestamp;
+    int32_t raw;
+    float weight;
+    float filamentWeight;
+    float rate;             // g/h, NAN if unknown
+    float eta;              // Seconds, NAN if unknown
+    int16_t selectedVessel;
+    uint8_t channel;
+    bool stable;
+    bool hasVessel;
+};
+
+inline void putLE16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+inline void putLE32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+// Grams to milligrams without going through text formatting
+inline int32_t toMilligrams(float grams) {
+    return (int32_t)lroundf(grams * 1000.0f);
+}
+
+// Writes TELEMETRY_FRAME_SIZE bytes to out
+inline size_t encodeBinaryTelemetry(const TelemetrySnapshot& snapshot, uint8_t* out) {
+    uint16_t flags = 0;
+    if (snapshot.stable) flags |= TELEMETRY_FLAG_STABLE;
+    if (snapshot.hasVessel) flags |= TELEMETRY_FLAG_VESSEL;
+
+    out[0] = TELEMETRY_MAGIC;
+    out[1] = TELEMETRY_VERSION;
+    putLE16(out + 2, flags);
+    putLE32(out + 4, snapshot.seq);
+    putLE32(out + 8, snapshot.timestamp);
+    putLE32(out + 12, (uint32_t)snapshot.raw);
+    putLE32(out + 16, (uint32_t)toMilligrams(snapshot.weight));
+    putLE32(out + 20, (uint32_t)(snapshot.hasVessel ? toMilligrams(snapshot.filamentWeight) : 0));
+    putLE16(out + 24, (uint16_t)snapshot.selectedVessel);
+    putLE32(out + 26, isnan(snapshot.rate) ? (uint32_t)TELEMETRY_RATE_UNKNOWN : (uint32_t)toMilligrams(snapshot.rate));
+    putLE32(out + 30, isnan(snapshot.eta) ? TELEMETRY_ETA_UNKNOWN : (uint32_t)snapshot.eta);
+    out[34] = snapshot.channel;
+    return TELEMETRY_FRAME_SIZE;
+}
+
+// Raw sample stream, enabled per client with
+// {"command": "stream", "enabled": true, "batch": 16, "channel": 0}.
+//
+// Each binary frame carries a batch of consecutive samples straight from the
+// ring buffer of the streamed channel; one channel streams at a time:
+//   offset size field
+//   0      1    magic     STREAM_MAGIC ('S')
+//   1      1    version   STREAM_VERSION
+//   2      2    count     samples in this frame
+//   4      16*count samples:
+//          +0  4  seq        sample sequence number; a jump means samples were lost
+//          +4  4  timestamp  millis() when the sample was read
+//          +8  4  raw        signed ADC counts before tare offset
+//          +12 4  weight     filtered weight in milligrams
+#define STREAM_MAGIC        0x53
+#define STREAM_VERSION      1
+#define STREAM_HEADER_SIZE  4
+#define STREAM_SAMPLE_SIZE  16
+#define STREAM_MAX_BATCH    32
+
+inline void encodeStreamHeader(uint8_t* out, uint16_t count) {
+    out[0] = STREAM_MAGIC;
+    out[1] = STREAM_VERSION;
+    putLE16(out + 2, count);
+}
+
+inline void encodeStreamSample(uint8_t* out, uint32_t seq, uint32_t timestamp, int32_t raw, float weight) {
+    putLE32(out, seq);
+    putLE32(out + 4, timestamp);
+    putLE32(out + 8, (uint32_t)raw);
+    putLE32(out + 12, (uint32_t)toMilligrams(weight));
+}
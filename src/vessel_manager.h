@@ -1,128 +1,339 @@
 #pragma once
-#include <Preferences.h>
+#include <FS.h>
+#include <strings.h>
+#include <vector>
 #include "config.h"
+#include "vessel_store.h"
 
+// Vessel table with stable ids. Records are allocated as vessels are added;
+// two sorted indexes give O(log n) lookup by id and by name, and the name
+// index defines the order vessels are listed and scrolled in.
+//
+// The WebSocket task, loop() and the display all use the table, so every
+// public method takes the lock and readers get copies rather than pointers
+// into records another task may rename or delete.
+//
+// Every change bumps a version number and is kept in a short log, so clients
+// can be sent small deltas and catch up from the version they last saw.
+//
+// Each load cell channel has a vessel of its own bound to it. Channel 0
+// falls back to the first vessel like a single scale always did; other
+// channels stay unbound (0) until a vessel is picked for them.
 class VesselManager {
 public:
-    VesselManager() : vesselCount(0), selectedVesselIndex(0) {
-        // First open preferences in read/write mode
-        if (!preferences.begin("vessels", false)) {
-            Serial.println("Failed to initialize preferences");
-            return;
-        }
+    enum ChangeType : uint8_t {
+        VESSEL_ADDED,
+        VESSEL_UPDATED,
+        VESSEL_DELETED,
+        VESSEL_SELECTED
+    };
+
+    struct Change {
+        uint32_t version;
+        ChangeType type;
+        uint16_t id;
+        uint8_t channel;    // VESSEL_SELECTED only
+    };
+
+    static constexpr uint8_t CHANGE_LOG_SIZE = 32;
+
+    explicit VesselManager(fs::FS& fs) : store(fs), nextId(1), version(0) {
+        lock = xSemaphoreCreateMutex();
+        logMux = portMUX_INITIALIZER_UNLOCKED;
+        memset(changeLog, 0, sizeof(changeLog));
+        memset(selectedVesselIds, 0, sizeof(selectedVesselIds));
+        byId.reserve(MAX_VESSELS);
+        byName.reserve(MAX_VESSELS);
 
         // Load existing vessels
-        loadFromPreferences();
+        uint16_t selected[SCALE_CHANNELS];
+        store.load([this](const VesselConfig& vessel) {
+            if (byId.size() >= MAX_VESSELS || findVessel(vessel.id)) return;
+            insert(new VesselConfig(vessel));
+            if (vessel.id >= nextId) nextId = vessel.id + 1;
+        }, selected);
+        for (uint8_t channel = 0; channel < SCALE_CHANNELS; channel++) {
+            selectedVesselIds[channel] = findVessel(selected[channel]) ? selected[channel] : fallbackId(channel);
+        }
+        Serial.printf("Loaded %d vessels\n", (int)byId.size());
     }
 
+    // No other task may use the table any more; staged changes are still written
     ~VesselManager() {
-        preferences.end();
+        for (VesselConfig* vessel : byId) delete vessel;
+        vSemaphoreDelete(lock);
     }
 
-    bool addVessel(const char* name, float vesselWeight, float spoolWeight) {
-        if (vesselCount >= MAX_VESSELS) return false;
+    // Owns the records the indexes point to
+    VesselManager(const VesselManager&) = delete;
+    VesselManager& operator=(const VesselManager&) = delete;
 
-        VesselConfig& vessel = vessels[vesselCount];
-        strncpy(vessel.name, name, sizeof(vessel.name) - 1);
-        vessel.name[sizeof(vessel.name) - 1] = '\0';
-        vessel.vesselWeight = vesselWeight;
-        vessel.spoolWeight = spoolWeight;
-        vesselCount++;
-        saveToPreferences();
-        return true;
+    // Returns the new vessel's id, 0 if the table is full
+    uint16_t addVessel(const char* name, float vesselWeight, float spoolWeight) {
+        Guard guard(lock);
+        if (byId.size() >= MAX_VESSELS) return 0;
+
+        VesselConfig* vessel = new VesselConfig();
+        memset(vessel, 0, sizeof(*vessel));
+        snprintf(vessel->name, sizeof(vessel->name), "%s", name);
+        vessel->vesselWeight = vesselWeight;
+        vessel->spoolWeight = spoolWeight;
+        vessel->id = allocateId();
+        insert(vessel);
+        store.stageVessel(*vessel);
+        logChange(VESSEL_ADDED, vessel->id);
+        if (selectedVesselIds[0] == 0) select(vessel->id, 0);
+        return vessel->id;
     }
 
-    bool updateVessel(int index, const char* name, float vesselWeight, float spoolWeight) {
-        if (index < 0 || index >= vesselCount) return false;
+    bool updateVessel(int id, const char* name, float vesselWeight, float spoolWeight) {
+        Guard guard(lock);
+        VesselConfig* vessel = findVessel(id);
+        if (!vessel) return false;
 
-        VesselConfig& vessel = vessels[index];
-        strncpy(vessel.name, name, sizeof(vessel.name) - 1);
-        vessel.name[sizeof(vessel.name) - 1] = '\0';
-        vessel.vesselWeight = vesselWeight;
-        vessel.spoolWeight = spoolWeight;
+        // Renaming moves the vessel in the name index
+        eraseFromNameIndex(vessel);
+        memset(vessel->name, 0, sizeof(vessel->name));
+        snprintf(vessel->name, sizeof(vessel->name), "%s", name);
+        vessel->vesselWeight = vesselWeight;
+        vessel->spoolWeight = spoolWeight;
+        byName.insert(nameLowerBound(vessel->name, vessel->id), vessel);
 
-        saveToPreferences();
+        store.stageVessel(*vessel);
+        logChange(VESSEL_UPDATED, id);
         return true;
     }
 
-    bool deleteVessel(int index) {
-        if (index < 0 || index >= vesselCount) return false;
+    bool deleteVessel(int id) {
+        Guard guard(lock);
+        VesselConfig* vessel = findVessel(id);
+        if (!vessel) return false;
 
-        // Shift remaining vessels left
-        for (int i = index; i < vesselCount - 1; i++) {
-            vessels[i] = vessels[i + 1];
+        eraseFromNameIndex(vessel);
+        byId.erase(idLowerBound(id));
+        store.stageDelete(id);
+        delete vessel;
+        logChange(VESSEL_DELETED, id);
+
+        for (uint8_t channel = 0; channel < SCALE_CHANNELS; channel++) {
+            if (selectedVesselIds[channel] == id) select(fallbackId(channel), channel);
         }
-        vesselCount--;
+        return true;
+    }
 
-        saveToPreferences();
+    // Copies the vessel; false for unknown ids
+    bool getVessel(int id, VesselConfig& out) const {
+        Guard guard(lock);
+        const VesselConfig* vessel = findVessel(id);
+        if (vessel) out = *vessel;
+        return vessel != nullptr;
+    }
+
+    bool hasVessel(int id) const {
+        Guard guard(lock);
+        return findVessel(id) != nullptr;
+    }
+
+    // Copies the vessel at a position in name order; false past the end
+    bool getVesselAt(int position, VesselConfig& out) const {
+        Guard guard(lock);
+        if (position < 0 || position >= (int)byName.size()) return false;
+        out = *byName[position];
         return true;
     }
 
-    VesselConfig* getVessel(int index) {
-        if (index < 0 || index >= vesselCount) return nullptr;
-        return &vessels[index];
+    // Position in name order, -1 for unknown ids
+    int positionOf(int id) const {
+        Guard guard(lock);
+        const VesselConfig* vessel = findVessel(id);
+        if (!vessel) return -1;
+        return nameLowerBound(vessel->name, vessel->id) - byName.begin();
+    }
+
+    // Copies up to limit vessels in name order after (name, id) into out and returns how
+    // many; pass an empty name for the start. more tells whether any follow. The cursor
+    // stays valid even if that vessel is deleted meanwhile.
+    int getVesselsAfter(const char* name, int id, VesselConfig* out, int limit, bool& more) const {
+        Guard guard(lock);
+        ConstIterator it = nameLowerBound(name, id + 1);
+        int count = 0;
+        for (; it != byName.end() && count < limit; ++it) {
+            out[count++] = **it;
+        }
+        more = it != byName.end();
+        return count;
     }
 
     int getVesselCount() const {
-        return vesselCount;
+        Guard guard(lock);
+        return byId.size();
     }
 
-    void setSelectedVessel(int index) {
-        if (index >= 0 && index < vesselCount) {
-            selectedVesselIndex = index;
-            saveToPreferences();
-        }
+    // Bind a vessel to a channel; 0 unbinds it
+    void setSelectedVessel(int id, uint8_t channel = 0) {
+        Guard guard(lock);
+        select(id, channel);
+    }
+
+    // Id of the vessel on a channel, 0 if none
+    int getSelectedVessel(uint8_t channel = 0) const {
+        Guard guard(lock);
+        return channel < SCALE_CHANNELS ? selectedVesselIds[channel] : 0;
+    }
+
+    // Copies the vessel on a channel; false if none is bound
+    bool getSelectedVessel(uint8_t channel, VesselConfig& out) const {
+        Guard guard(lock);
+        const VesselConfig* vessel = channel < SCALE_CHANNELS ? findVessel(selectedVesselIds[channel]) : nullptr;
+        if (vessel) out = *vessel;
+        return vessel != nullptr;
     }
 
-    int getSelectedVessel() const {
-        return selectedVesselIndex;
+    // Bumped by every change, including selection
+    uint32_t getVersion() const {
+        portENTER_CRITICAL(&logMux);
+        uint32_t current = version;
+        portEXIT_CRITICAL(&logMux);
+        return current;
+    }
+
+    // The change that produced a version; false once it has dropped out of the log
+    bool getChange(uint32_t changeVersion, Change& out) const {
+        portENTER_CRITICAL(&logMux);
+        out = changeLog[changeVersion % CHANGE_LOG_SIZE];
+        portEXIT_CRITICAL(&logMux);
+        return changeVersion != 0 && out.version == changeVersion;
     }
 
 private:
-    void loadFromPreferences() {
-        // Load vessel count and selection
-        vesselCount = preferences.getInt("count", 0);
-        selectedVesselIndex = preferences.getInt("selected", 0);
+    typedef std::vector<VesselConfig*>::iterator Iterator;
+    typedef std::vector<VesselConfig*>::const_iterator ConstIterator;
 
-        Serial.printf("Loading %d vessels from preferences\n", vesselCount);
+    // Holds the table lock for a scope
+    class Guard {
+    public:
+        explicit Guard(SemaphoreHandle_t lock) : lock(lock) { xSemaphoreTake(lock, portMAX_DELAY); }
+        ~Guard() { xSemaphoreGive(lock); }
+    private:
+        SemaphoreHandle_t lock;
+    };
 
-        // Ensure selected index is valid
-        if (selectedVesselIndex >= vesselCount) {
-            selectedVesselIndex = 0;
+    static int compareNames(const char* name, int id, const VesselConfig* vessel) {
+        int order = strcasecmp(name, vessel->name);
+        if (order == 0) order = strcmp(name, vessel->name);
+        if (order == 0) order = id - vessel->id;
+        return order;
+    }
+
+    // The helpers below expect the lock to be held
+
+    template <class It>
+    static It idLowerBound(It lo, It hi, int id) {
+        while (lo < hi) {
+            It mid = lo + (hi - lo) / 2;
+            if ((*mid)->id < id) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
         }
+        return lo;
+    }
 
-        for (int i = 0; i < vesselCount; i++) {
-            String prefix = "vessel" + String(i) + "_";
-            preferences.getString((prefix + "name").c_str(), vessels[i].name, sizeof(vessels[i].name));
-            vessels[i].vesselWeight = preferences.getFloat((prefix + "weight").c_str(), 0.0f);
-            vessels[i].spoolWeight = preferences.getFloat((prefix + "spool").c_str(), 0.0f);
+    // First entry not ordered before (name, id); names compare case-insensitively, ids break ties
+    template <class It>
+    static It nameLowerBound(It lo, It hi, const char* name, int id) {
+        while (lo < hi) {
+            It mid = lo + (hi - lo) / 2;
+            if (compareNames(name, id, *mid) > 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
         }
+        return lo;
+    }
+
+    Iterator idLowerBound(int id) {
+        return idLowerBound(byId.begin(), byId.end(), id);
+    }
+
+    ConstIterator idLowerBound(int id) const {
+        return idLowerBound(byId.cbegin(), byId.cend(), id);
+    }
+
+    Iterator nameLowerBound(const char* name, int id) {
+        return nameLowerBound(byName.begin(), byName.end(), name, id);
     }
 
-    void saveToPreferences() {
-        Serial.printf("Saving %d vessels to preferences\n", vesselCount);
+    ConstIterator nameLowerBound(const char* name, int id) const {
+        return nameLowerBound(byName.cbegin(), byName.cend(), name, id);
+    }
 
-        // Clear all preferences to avoid stale data
-        preferences.clear();
+    // nullptr for unknown ids
+    VesselConfig* findVessel(int id) const {
+        if (id <= 0) return nullptr;
+        ConstIterator it = idLowerBound(id);
+        return it != byId.end() && (*it)->id == id ? *it : nullptr;
+    }
 
-        // Save current state
-        preferences.putInt("count", vesselCount);
-        preferences.putInt("selected", selectedVesselIndex);
-        for (int i = 0; i < vesselCount; i++) {
-            String prefix = "vessel" + String(i) + "_";
-            preferences.putString((prefix + "name").c_str(), vessels[i].name);
-            preferences.putFloat((prefix + "weight").c_str(), vessels[i].vesselWeight);
-            preferences.putFloat((prefix + "spool").c_str(), vessels[i].spoolWeight);
+    void select(int id, uint8_t channel) {
+        if (channel < SCALE_CHANNELS && id != selectedVesselIds[channel] && (id == 0 || findVessel(id))) {
+            selectedVesselIds[channel] = id;
+            store.stageSelection(channel, id);
+            logChange(VESSEL_SELECTED, id, channel);
         }
+    }
 
-        // Ensure changes are written to flash
-        if (!preferences.isKey("count")) {
-            Serial.println("Warning: Failed to save vessel count");
+    void insert(VesselConfig* vessel) {
+        byId.insert(idLowerBound(vessel->id), vessel);
+        byName.insert(nameLowerBound(vessel->name, vessel->id), vessel);
+    }
+
+    void eraseFromNameIndex(VesselConfig* vessel) {
+        Iterator it = nameLowerBound(vessel->name, vessel->id);
+        if (it != byName.end() && *it == vessel) byName.erase(it);
+    }
+
+    // Ids count up and are not handed out again until they wrap
+    uint16_t allocateId() {
+        while (nextId == 0 || nextId > MAX_VESSEL_ID || findVessel(nextId)) {
+            nextId = nextId == 0 || nextId > MAX_VESSEL_ID ? 1 : nextId + 1;
         }
+        return nextId++;
+    }
+
+    void logChange(ChangeType type, uint16_t id, uint8_t channel = 0) {
+        portENTER_CRITICAL(&logMux);
+        version++;
+        Change& change = changeLog[version % CHANGE_LOG_SIZE];
+        change.version = version;
+        change.type = type;
+        change.id = id;
+        change.channel = channel;
+        portEXIT_CRITICAL(&logMux);
     }
 
-    VesselConfig vessels[MAX_VESSELS];
-    int vesselCount;
-    int selectedVesselIndex;
-    Preferences preferences;
+    int firstId() const {
+        return byName.empty() ? 0 : byName.front()->id;
+    }
+
+    // What a channel shows when its vessel is gone
+    int fallbackId(uint8_t channel) const {
+        return channel == 0 ? firstId() : 0;
+    }
+
+    // Telemetry carries the selected id as int16
+    static constexpr uint16_t MAX_VESSEL_ID = 32767;
+
+    VesselStore store;
+    mutable SemaphoreHandle_t lock;
+    std::vector<VesselConfig*> byId;
+    std::vector<VesselConfig*> byName;
+    uint16_t nextId;
+    int selectedVesselIds[SCALE_CHANNELS];
+
+    mutable portMUX_TYPE logMux;
+    uint32_t version;
+    Change changeLog[CHANGE_LOG_SIZE];
 };
@@ -0,0 +1,390 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <Preferences.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include "config.h"
+#include "metrics.h"
+#include "profiler.h"
+
+// Flash persistence for the vessel table.
+//
+// Vessels live in a file of fixed-size records on the flash filesystem, one
+// slot per vessel, each with its own CRC32. A change rewrites only the slot
+// of the vessel it touched; deleted slots are reused. The vessel selected on
+// each channel is a separate NVS key, so scrolling through vessels never
+// touches the file.
+//
+// Callers stage changes in RAM; a background task writes them once no change
+// has arrived for DEBOUNCE_MS (at the latest MAX_DELAY_MS after the first
+// one), so UI code never waits on flash. Destroying the store writes what is
+// still staged and stops the task.
+class VesselStore {
+public:
+    static constexpr uint16_t FILE_VERSION = 1;
+    static constexpr uint32_t DEBOUNCE_MS = 2000;
+    static constexpr uint32_t MAX_DELAY_MS = 10000;
+
+    explicit VesselStore(fs::FS& fs)
+        : fs(fs), worker(nullptr), stopping(false), stopper(nullptr), selectionDirty(false) {
+        lock = xSemaphoreCreateMutex();
+        memset(pendingSelected, 0, sizeof(pendingSelected));
+        memset(writtenSelected, 0, sizeof(writtenSelected));
+    }
+
+    ~VesselStore() {
+        if (worker) {
+            // Wait for the worker to flush and let go of the store
+            stopper = xTaskGetCurrentTaskHandle();
+            stopping = true;
+            xTaskNotifyGive(worker);
+            while (stopping) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        vSemaphoreDelete(lock);
+    }
+
+    // The worker task holds a pointer to the store
+    VesselStore(const VesselStore&) = delete;
+    VesselStore& operator=(const VesselStore&) = delete;
+
+    // Calls add(const VesselConfig&) for every stored vessel and fills
+    // selected[SCALE_CHANNELS] with the id selected on each channel.
+    // Tables saved in NVS by older firmware are moved to the file on first boot.
+    template <class AddFn>
+    void load(AddFn add, uint16_t* selected) {
+        if (!preferences.begin("vessels", false)) {
+            Serial.println("Failed to initialize preferences");
+        }
+
+        if (!fs.exists(path())) {
+            migrateFromPreferences();
+        }
+
+        File file = fs.open(path(), "r");
+        FileHeader header;
+        if (file && file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == FILE_MAGIC && header.version == FILE_VERSION && header.recordSize == sizeof(Record)) {
+            Record record;
+            while (file.read((uint8_t*)&record, sizeof(record)) == sizeof(record)) {
+                bool valid = record.vessel.id != 0 &&
+                    record.crc == vesselCrc(record.vessel);
+                if (record.vessel.id != 0 && !valid) {
+                    Serial.printf("Vessel slot %u is corrupt, skipping it\n", (unsigned)slotIds.size());
+                }
+                slotIds.push_back(valid ? record.vessel.id : 0);
+                if (valid) {
+                    record.vessel.name[sizeof(record.vessel.name) - 1] = '\0';
+                    add(record.vessel);
+                }
+            }
+        } else if (file) {
+            Serial.println("Stored vessel table has an unknown format, starting empty");
+        }
+        file.close();
+
+        for (uint8_t channel = 0; channel < SCALE_CHANNELS; channel++) {
+            char key[16];
+            writtenSelected[channel] = preferences.getUShort(selectionKey(channel, key), 0);
+            pendingSelected[channel] = writtenSelected[channel];
+            selected[channel] = writtenSelected[channel];
+        }
+
+        xTaskCreate(workerEntry, "persist", WORKER_STACK, this, WORKER_PRIORITY, &worker);
+    }
+
+    // Queue an added or changed vessel
+    void stageVessel(const VesselConfig& vessel) {
+        Change change;
+        change.vessel = vessel;
+        change.deleted = false;
+        stage(change);
+    }
+
+    void stageDelete(uint16_t id) {
+        Change change;
+        memset(&change.vessel, 0, sizeof(change.vessel));
+        change.vessel.id = id;
+        change.deleted = true;
+        stage(change);
+    }
+
+    void stageSelection(uint8_t channel, uint16_t id) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        pendingSelected[channel] = id;
+        selectionDirty = true;
+        xSemaphoreGive(lock);
+        notify();
+    }
+
+private:
+    static const char* path() { return "/vessels.dat"; }
+    static const char* tempPath() { return "/vessels.tmp"; }
+
+    // Channel 0 keeps the key single-scale firmware used
+    static const char* selectionKey(uint8_t channel, char* key) {
+        if (channel == 0) return "selectedId";
+        snprintf(key, 16, "selectedId%u", channel);
+        return key;
+    }
+
+    static constexpr uint32_t FILE_MAGIC = 0x4C535356;  // "VSSL"
+    static constexpr uint32_t WORKER_STACK = 4096;
+    static constexpr UBaseType_t WORKER_PRIORITY = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+    };
+
+    struct Record {
+        VesselConfig vessel;    // id 0 marks a free slot
+        uint32_t crc;           // CRC32 of vessel
+    };
+
+    struct Change {
+        VesselConfig vessel;
+        bool deleted;
+    };
+
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) {
+            crc ^= data[i];
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+            }
+        }
+        return ~crc;
+    }
+
+    // Field by field, so struct padding never affects the checksum
+    static uint32_t vesselCrc(const VesselConfig& vessel) {
+        uint32_t crc = crc32((const uint8_t*)vessel.name, sizeof(vessel.name));
+        crc = crc32((const uint8_t*)&vessel.vesselWeight, sizeof(vessel.vesselWeight), crc);
+        crc = crc32((const uint8_t*)&vessel.spoolWeight, sizeof(vessel.spoolWeight), crc);
+        return crc32((const uint8_t*)&vessel.id, sizeof(vessel.id), crc);
+    }
+
+    // A newer change to the same vessel replaces one that wasn't written yet
+    void stage(const Change& change) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool merged = false;
+        for (Change& queued : pending) {
+            if (queued.vessel.id == change.vessel.id) {
+                queued = change;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) pending.push_back(change);
+        xSemaphoreGive(lock);
+        notify();
+    }
+
+    void notify() {
+        if (worker) xTaskNotifyGive(worker);
+    }
+
+    static void workerEntry(void* arg) {
+        static_cast<VesselStore*>(arg)->workerLoop();
+        vTaskDelete(nullptr);
+    }
+
+    void workerLoop() {
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            // Wait for the changes to stop, e.g. the encoder to come to rest
+            TickType_t first = xTaskGetTickCount();
+            while (!stopping && xTaskGetTickCount() - first < pdMS_TO_TICKS(MAX_DELAY_MS) &&
+                   ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DEBOUNCE_MS)) > 0) {
+            }
+
+            {
+                PROFILE_SECTION(PROFILE_VESSEL_PERSIST);
+                writeChanges();
+                writeSelection();
+            }
+            if (stopping) {
+                // The store may be gone as soon as stopping is cleared
+                TaskHandle_t waiting = stopper;
+                stopping = false;
+                xTaskNotifyGive(waiting);
+                return;
+            }
+        }
+    }
+
+    void writeChanges() {
+        std::vector<Change> changes;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        changes.swap(pending);
+        xSemaphoreGive(lock);
+        if (changes.empty()) return;
+
+        File file = fs.open(path(), "r+");
+        if (!file) {
+            Serial.println("Warning: Failed to open vessel table");
+            return;
+        }
+        for (const Change& change : changes) {
+            int slot = findSlot(change.vessel.id);
+            if (change.deleted) {
+                if (slot < 0) continue;
+                Record record;
+                memset(&record, 0, sizeof(record));
+                writeRecord(file, slot, record);
+                slotIds[slot] = 0;
+            } else {
+                if (slot < 0) {
+                    // Reuse a freed slot before growing the file
+                    slot = findSlot(0);
+                    if (slot < 0) {
+                        slot = slotIds.size();
+                        slotIds.push_back(0);
+                    }
+                }
+                Record record;
+                memset(&record, 0, sizeof(record));
+                memcpy(record.vessel.name, change.vessel.name, sizeof(record.vessel.name));
+                record.vessel.vesselWeight = change.vessel.vesselWeight;
+                record.vessel.spoolWeight = change.vessel.spoolWeight;
+                record.vessel.id = change.vessel.id;
+                record.crc = vesselCrc(record.vessel);
+                writeRecord(file, slot, record);
+                slotIds[slot] = change.vessel.id;
+            }
+        }
+        file.close();
+        Serial.printf("Saved %u vessel changes\n", (unsigned)changes.size());
+    }
+
+    void writeRecord(File& file, int slot, const Record& record) {
+        if (!file.seek(sizeof(FileHeader) + slot * sizeof(Record)) ||
+            file.write((const uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+            Serial.printf("Warning: Failed to save vessel slot %d\n", slot);
+            return;
+        }
+        metrics.vesselFileWrites.inc();
+    }
+
+    void writeSelection() {
+        uint16_t selected[SCALE_CHANNELS];
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool dirty = selectionDirty;
+        selectionDirty = false;
+        memcpy(selected, pendingSelected, sizeof(selected));
+        xSemaphoreGive(lock);
+        if (!dirty) return;
+
+        for (uint8_t channel = 0; channel < SCALE_CHANNELS; channel++) {
+            if (selected[channel] == writtenSelected[channel]) continue;
+            char key[16];
+            if (preferences.putUShort(selectionKey(channel, key), selected[channel]) == 0) {
+                Serial.println("Warning: Failed to save vessel selection");
+                continue;
+            }
+            metrics.vesselNvsWrites.inc();
+            writtenSelected[channel] = selected[channel];
+        }
+    }
+
+    int findSlot(uint16_t id) const {
+        for (size_t i = 0; i < slotIds.size(); i++) {
+            if (slotIds[i] == id) return i;
+        }
+        return -1;
+    }
+
+    // Move vessels saved in NVS (a CRC-checked blob, or one key per field before
+    // that) into a new file, numbering them in their old order.
+    void migrateFromPreferences() {
+        struct LegacyVessel {
+            char name[32];
+            float vesselWeight;
+            float spoolWeight;
+        };
+        struct LegacyTable {
+            uint16_t version;
+            uint16_t count;
+            LegacyVessel vessels[LEGACY_MAX_VESSELS];
+            uint32_t crc;
+        };
+
+        LegacyTable table;
+        memset(&table, 0, sizeof(table));
+        int selected = -1;
+        if (preferences.getBytesLength("table") == sizeof(table) &&
+            preferences.getBytes("table", &table, sizeof(table)) == sizeof(table) &&
+            table.version == 1 && table.count <= LEGACY_MAX_VESSELS &&
+            table.crc == crc32((const uint8_t*)&table, offsetof(LegacyTable, crc))) {
+            selected = preferences.getUChar("selected", 0);
+        } else if (preferences.isKey("count")) {
+            int count = preferences.getInt("count", 0);
+            table.count = count > 0 && count <= LEGACY_MAX_VESSELS ? count : 0;
+            selected = preferences.getInt("selected", 0);
+            for (int i = 0; i < table.count; i++) {
+                String prefix = "vessel" + String(i) + "_";
+                preferences.getString((prefix + "name").c_str(), table.vessels[i].name, sizeof(table.vessels[i].name));
+                table.vessels[i].vesselWeight = preferences.getFloat((prefix + "weight").c_str(), 0.0f);
+                table.vessels[i].spoolWeight = preferences.getFloat((prefix + "spool").c_str(), 0.0f);
+            }
+        }
+
+        // Written to a temporary file and renamed into place, so a failed write leaves
+        // no partial table behind; NVS is only cleared once the table is in place
+        File file = fs.open(tempPath(), "w");
+        if (!file) {
+            Serial.println("Warning: Failed to create vessel table");
+            return;
+        }
+        FileHeader header = {FILE_MAGIC, FILE_VERSION, sizeof(Record)};
+        bool written = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+        for (uint16_t i = 0; written && i < table.count; i++) {
+            Record record;
+            memset(&record, 0, sizeof(record));
+            strncpy(record.vessel.name, table.vessels[i].name, sizeof(record.vessel.name) - 1);
+            record.vessel.vesselWeight = table.vessels[i].vesselWeight;
+            record.vessel.spoolWeight = table.vessels[i].spoolWeight;
+            record.vessel.id = i + 1;
+            record.crc = vesselCrc(record.vessel);
+            written = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+        }
+        file.close();
+        if (!written || !fs.rename(tempPath(), path())) {
+            Serial.println("Warning: Failed to move vessels from preferences, keeping them there");
+            fs.remove(tempPath());
+            return;
+        }
+
+        if (table.count > 0) {
+            Serial.printf("Moved %u vessels from preferences to %s\n", table.count, path());
+        }
+        preferences.clear();
+        if (selected >= 0 && selected < table.count) {
+            preferences.putUShort("selectedId", selected + 1);
+        }
+    }
+
+    static constexpr uint16_t LEGACY_MAX_VESSELS = 10;
+
+    fs::FS& fs;
+    Preferences preferences;
+    TaskHandle_t worker;
+    std::atomic<bool> stopping;
+    TaskHandle_t stopper;       // Task waiting in the destructor
+    SemaphoreHandle_t lock;
+
+    // Guarded by lock
+    std::vector<Change> pending;
+    uint16_t pendingSelected[SCALE_CHANNELS];
+    bool selectionDirty;
+
+    // Owned by the worker after load(): vessel id stored in each file slot, 0 if free
+    std::vector<uint16_t> slotIds;
+    uint16_t writtenSelected[SCALE_CHANNELS];
+};
@@ -0,0 +1,126 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+#ifdef WEB_ASSETS_IN_FLASH
+#include "web_assets_data.h"
+#endif
+
+// Serves the web UI prepared by tools/build_web.py: every file is stored
+// gzipped, and the manifest gives each URL a strong ETag. Content-hashed
+// files are cached by the browser for a year; pages are revalidated on every
+// load and answered with 304 while unchanged, so a reload costs a few
+// hundred bytes.
+//
+// Built with WEB_ASSETS_IN_FLASH (custom_web_assets = flash), the files are
+// compiled into the firmware and sent straight from memory-mapped flash; the
+// filesystem is then not needed to serve the UI, and firmware and UI are
+// always updated together.
+class WebAssets : public AsyncWebHandler {
+public:
+    explicit WebAssets(fs::FS& fs) : fs(fs) {}
+
+#ifdef WEB_ASSETS_IN_FLASH
+    bool begin() {
+        for (size_t i = 0; i < EMBEDDED_ASSET_COUNT; i++) {
+            const EmbeddedAsset& embedded = EMBEDDED_ASSETS[i];
+            Asset asset;
+            asset.path = embedded.path;
+            asset.etag = "\"" + String(embedded.etag) + "\"";
+            asset.immutable = embedded.immutable;
+            asset.contentType = embedded.contentType;
+            asset.data = embedded.data;
+            asset.length = embedded.length;
+            assets.push_back(asset);
+        }
+        Serial.printf("Serving %u web assets from flash\n", (unsigned)assets.size());
+        return true;
+    }
+#else
+    // Reads the manifest; false if the filesystem image has none
+    bool begin() {
+        File manifest = fs.open(manifestPath(), "r");
+        if (!manifest) {
+            Serial.println("Warning: No web asset manifest, upload the filesystem image");
+            return false;
+        }
+        while (manifest.available()) {
+            String line = manifest.readStringUntil('\n');
+            int first = line.indexOf(' ');
+            int second = line.indexOf(' ', first + 1);
+            if (first <= 0 || second <= first) continue;
+
+            Asset asset;
+            asset.path = line.substring(0, first);
+            asset.etag = "\"" + line.substring(first + 1, second) + "\"";
+            asset.immutable = line.charAt(second + 1) == '1';
+            asset.contentType = nullptr;
+            asset.data = nullptr;
+            asset.length = 0;
+            assets.push_back(asset);
+        }
+        manifest.close();
+        Serial.printf("Serving %u web assets\n", (unsigned)assets.size());
+        return true;
+    }
+#endif
+
+    bool canHandle(AsyncWebServerRequest* request) override {
+        if (request->method() != HTTP_GET && request->method() != HTTP_HEAD) return false;
+        if (!find(request->url())) return false;
+        request->addInterestingHeader("If-None-Match");
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest* request) override {
+        const Asset* asset = find(request->url());
+        if (!asset) {
+            request->send(404);
+            return;
+        }
+
+        AsyncWebServerResponse* response;
+        if (request->hasHeader("If-None-Match") &&
+            request->header("If-None-Match") == asset->etag) {
+            response = request->beginResponse(304);
+        } else if (asset->data) {
+            response = request->beginResponse_P(200, asset->contentType, asset->data, asset->length);
+            response->addHeader("Content-Encoding", "gzip");
+        } else {
+            // A ".gz" file served under its plain name gets Content-Encoding: gzip
+            File file = fs.open(asset->path + ".gz", "r");
+            if (!file) {
+                request->send(404);
+                return;
+            }
+            response = request->beginResponse(file, asset->path);
+        }
+        response->addHeader("ETag", asset->etag);
+        response->addHeader("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+        request->send(response);
+    }
+
+private:
+    struct Asset {
+        String path;
+        String etag;        // Quoted, as sent and compared
+        bool immutable;     // Content-hashed name
+        const char* contentType;
+        const uint8_t* data;    // Gzipped, in flash; nullptr if the file is on the filesystem
+        size_t length;
+    };
+
+    static const char* manifestPath() { return "/assets.txt"; }
+
+    const Asset* find(const String& url) const {
+        String path = url == "/" ? String("/index.html") : url;
+        for (const Asset& asset : assets) {
+            if (asset.path == path) return &asset;
+        }
+        return nullptr;
+    }
+
+    fs::FS& fs;
+    std::vector<Asset> assets;
+};
@@ -0,0 +1,282 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Streaming filters for HX711 readings. Every stage works on a fixed-size
+// window owned by the stage itself, so nothing allocates once the Scale exists.
+
+struct FilterConfig {
+    bool outlierEnabled;
+    float outlierSigma;     // Reject readings further than this many standard deviations from the mean
+    bool medianEnabled;
+    uint8_t medianWindow;   // Samples in the rolling median
+    bool emaEnabled;
+    float emaAlpha;         // Weight of the newest sample, 0..1
+};
+
+inline FilterConfig defaultFilterConfig() {
+    FilterConfig config;
+    config.outlierEnabled = false;
+    config.outlierSigma = 3.0f;
+    config.medianEnabled = false;
+    config.medianWindow = 5;
+    config.emaEnabled = false;
+    config.emaAlpha = 0.2f;
+    return config;
+}
+
+// Windowed mean/variance using Welford's update with removal of the oldest
+// sample. Exact sums are recomputed every RESYNC_INTERVAL replacements so
+// float rounding can't accumulate over days of uptime.
+template <uint8_t N>
+class RollingStats {
+public:
+    static constexpr uint16_t RESYNC_INTERVAL = 1024;
+
+    RollingStats() {
+        reset();
+    }
+
+    void reset() {
+        n = 0;
+        pos = 0;
+        runningMean = 0.0f;
+        m2 = 0.0f;
+        replacements = 0;
+    }
+
+    void push(float x) {
+        if (n < N) {
+            window[pos] = x;
+            n++;
+            float delta = x - runningMean;
+            runningMean += delta / n;
+            m2 += delta * (x - runningMean);
+        } else {
+            float old = window[pos];
+            window[pos] = x;
+            float newMean = runningMean + (x - old) / N;
+            m2 += (x - old) * (x - newMean + old - runningMean);
+            runningMean = newMean;
+            if (++replacements >= RESYNC_INTERVAL) resync();
+        }
+        if (m2 < 0.0f) m2 = 0.0f;
+        pos = (pos + 1) % N;
+    }
+
+    uint8_t count() const { return n; }
+    bool full() const { return n == N; }
+    float mean() const { return runningMean; }
+    float variance() const { return n > 1 ? m2 / (n - 1) : 0.0f; }
+    float stddev() const { return sqrtf(variance()); }
+
+private:
+    void resync() {
+        float sum = 0.0f;
+        for (uint8_t i = 0; i < n; i++) sum += window[i];
+        runningMean = sum / n;
+        m2 = 0.0f;
+        for (uint8_t i = 0; i < n; i++) {
+            float d = window[i] - runningMean;
+            m2 += d * d;
+        }
+        replacements = 0;
+    }
+
+    float window[N];
+    uint8_t n;
+    uint8_t pos;
+    float runningMean;
+    float m2;
+    uint16_t replacements;
+};
+
+// Rolling median over a sorted copy of the window. Each sample costs two
+// binary searches and one shift of the elements between the outgoing and
+// incoming value's positions.
+class MedianFilter {
+public:
+    static constexpr uint8_t MAX_WINDOW = 15;
+
+    MedianFilter() : window(5) {
+        reset();
+    }
+
+    void configure(uint8_t size) {
+        if (size < 1) size = 1;
+        if (size > MAX_WINDOW) size = MAX_WINDOW;
+        window = size;
+        reset();
+    }
+
+    void reset() {
+        count = 0;
+        pos = 0;
+    }
+
+    float process(float x) {
+        if (count < window) {
+            uint8_t j = lowerBound(x);
+            memmove(&sorted[j + 1], &sorted[j], (count - j) * sizeof(float));
+            sorted[j] = x;
+            count++;
+        } else {
+            float old = history[pos];
+            uint8_t i = lowerBound(old);
+            uint8_t j = lowerBound(x);
+            if (j > i) {
+                memmove(&sorted[i], &sorted[i + 1], (j - 1 - i) * sizeof(float));
+                sorted[j - 1] = x;
+            } else {
+                memmove(&sorted[j + 1], &sorted[j], (i - j) * sizeof(float));
+                sorted[j] = x;
+            }
+        }
+        history[pos] = x;
+        pos = (pos + 1) % window;
+
+        uint8_t mid = count / 2;
+        return (count & 1) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) * 0.5f;
+    }
+
+private:
+    // First index in sorted[0..count) whose value is >= v
+    uint8_t lowerBound(float v) const {
+        uint8_t lo = 0;
+        uint8_t hi = count;
+        while (lo < hi) {
+            uint8_t mid = (lo + hi) / 2;
+            if (sorted[mid] < v) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    float history[MAX_WINDOW];
+    float sorted[MAX_WINDOW];
+    uint8_t window;
+    uint8_t count;
+    uint8_t pos;
+};
+
+class EmaFilter {
+public:
+    EmaFilter() : alpha(0.2f), value(0.0f), primed(false) {}
+
+    void configure(float newAlpha) {
+        if (newAlpha <= 0.0f || newAlpha > 1.0f) newAlpha = 1.0f;
+        alpha = newAlpha;
+        reset();
+    }
+
+    void reset() {
+        primed = false;
+    }
+
+    float process(float x) {
+        if (!primed) {
+            value = x;
+            primed = true;
+        } else {
+            value += alpha * (x - value);
+        }
+        return value;
+    }
+
+private:
+    float alpha;
+    float value;
+    bool primed;
+};
+
+// Replaces readings that sit more than sigma standard deviations away from
+// the recent mean with the last accepted reading. Rejected readings still feed
+// the statistics, and after MAX_CONSECUTIVE_REJECTS in a row the reading is
+// accepted anyway, so a real load change (spool swap) gets through quickly.
+class OutlierFilter {
+public:
+    static constexpr uint8_t WINDOW = 16;
+    static constexpr uint8_t MIN_SAMPLES = 8;
+    static constexpr uint8_t MAX_CONSECUTIVE_REJECTS = 3;
+
+    OutlierFilter() : sigma(3.0f) {
+        reset();
+    }
+
+    void configure(float newSigma) {
+        if (newSigma < 1.0f) newSigma = 1.0f;
+        sigma = newSigma;
+        reset();
+    }
+
+    void reset() {
+        stats.reset();
+        rejected = 0;
+        lastAccepted = 0.0f;
+    }
+
+    float process(float x) {
+        bool outlier = false;
+        if (stats.count() >= MIN_SAMPLES && rejected < MAX_CONSECUTIVE_REJECTS) {
+            outlier = fabsf(x - stats.mean()) > sigma * stats.stddev();
+        }
+        stats.push(x);
+
+        if (outlier) {
+            rejected++;
+            return lastAccepted;
+        }
+        rejected = 0;
+        lastAccepted = x;
+        return x;
+    }
+
+private:
+    RollingStats<WINDOW> stats;
+    float sigma;
+    uint8_t rejected;
+    float lastAccepted;
+};
+
+// Fixed-order pipeline: outlier rejection -> median -> EMA.
+// Disabled stages are skipped entirely.
+class FilterChain {
+public:
+    FilterChain() {
+        configure(defaultFilterConfig());
+    }
+
+    void configure(const FilterConfig& newConfig) {
+        config = newConfig;
+        outlier.configure(config.outlierSigma);
+        median.configure(config.medianWindow);
+        ema.configure(config.emaAlpha);
+    }
+
+    void reset() {
+        outlier.reset();
+        median.reset();
+        ema.reset();
+    }
+
+    float process(float x) {
+        if (config.outlierEnabled) x = outlier.process(x);
+        if (config.medianEnabled) x = median.process(x);
+        if (config.emaEnabled) x = ema.process(x);
+        return x;
+    }
+
+    const FilterConfig& getConfig() const {
+        return config;
+    }
+
+private:
+    FilterConfig config;
+    OutlierFilter outlier;
+    MedianFilter median;
+    EmaFilter ema;
+};
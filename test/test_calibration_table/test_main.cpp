@@ -0,0 +1,115 @@
+// CalibrationTable (pio test -e native).
+#include <unity.h>
+#include "calibration_table.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_empty_table_maps_to_zero() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.isEmpty());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, table.apply(12345.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, table.countsPerGram());
+}
+
+static void test_single_point_is_a_line_through_tare() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.addPoint(42000.0f, 100.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, table.apply(0.0f));
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, table.apply(21000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, table.apply(42000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, table.apply(105000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(-10.0f, table.apply(-4200.0f));
+    TEST_ASSERT_EQUAL_FLOAT(420.0f, table.countsPerGram());
+}
+
+static void test_interpolates_between_points_and_extrapolates_last_segment() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.addPoint(1000.0f, 100.0f));
+    TEST_ASSERT_TRUE(table.addPoint(2100.0f, 200.0f));
+
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, table.apply(500.0f));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, table.apply(1000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(150.0f, table.apply(1550.0f));
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, table.apply(2100.0f));
+    TEST_ASSERT_EQUAL_FLOAT(300.0f, table.apply(3200.0f));
+    TEST_ASSERT_EQUAL_FLOAT(10.5f, table.countsPerGram());
+}
+
+static void test_points_are_kept_sorted_by_weight() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.addPoint(4000.0f, 400.0f));
+    TEST_ASSERT_TRUE(table.addPoint(1000.0f, 100.0f));
+    TEST_ASSERT_TRUE(table.addPoint(2000.0f, 200.0f));
+
+    TEST_ASSERT_EQUAL_UINT8(3, table.size());
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, table.getPoint(0).grams);
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, table.getPoint(1).grams);
+    TEST_ASSERT_EQUAL_FLOAT(400.0f, table.getPoint(2).grams);
+    TEST_ASSERT_EQUAL_FLOAT(300.0f, table.apply(3000.0f));
+}
+
+static void test_point_near_same_weight_replaces_old_one() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.addPoint(1000.0f, 100.0f));
+    TEST_ASSERT_TRUE(table.addPoint(1100.0f, 100.5f));
+
+    TEST_ASSERT_EQUAL_UINT8(1, table.size());
+    TEST_ASSERT_EQUAL_FLOAT(1100.0f, table.getPoint(0).counts);
+    TEST_ASSERT_EQUAL_FLOAT(100.5f, table.getPoint(0).grams);
+}
+
+static void test_rejects_invalid_points() {
+    CalibrationTable table;
+    TEST_ASSERT_FALSE(table.addPoint(1000.0f, 0.0f));
+    TEST_ASSERT_FALSE(table.addPoint(0.0f, 100.0f));
+    TEST_ASSERT_FALSE(table.addPoint(-1000.0f, 100.0f));
+    TEST_ASSERT_TRUE(table.isEmpty());
+
+    // More weight must mean more counts
+    TEST_ASSERT_TRUE(table.addPoint(2000.0f, 200.0f));
+    TEST_ASSERT_FALSE(table.addPoint(1500.0f, 300.0f));
+    TEST_ASSERT_FALSE(table.addPoint(2500.0f, 100.0f));
+    TEST_ASSERT_EQUAL_UINT8(1, table.size());
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, table.apply(1000.0f));
+}
+
+static void test_table_holds_at_most_max_points() {
+    CalibrationTable table;
+    for (uint8_t i = 1; i <= CalibrationTable::MAX_POINTS; i++) {
+        TEST_ASSERT_TRUE(table.addPoint(i * 1000.0f, i * 100.0f));
+    }
+    TEST_ASSERT_FALSE(table.addPoint(20000.0f, 2000.0f));
+    TEST_ASSERT_EQUAL_UINT8(CalibrationTable::MAX_POINTS, table.size());
+
+    // Replacing an existing weight still works when full
+    TEST_ASSERT_TRUE(table.addPoint(8100.0f, 800.0f));
+    TEST_ASSERT_EQUAL_UINT8(CalibrationTable::MAX_POINTS, table.size());
+}
+
+static void test_load_replaces_table_and_clears_on_invalid_input() {
+    CalibrationTable table;
+    TEST_ASSERT_TRUE(table.addPoint(1000.0f, 100.0f));
+
+    CalibrationTable::Point points[] = {{2000.0f, 100.0f}, {4200.0f, 200.0f}};
+    TEST_ASSERT_TRUE(table.load(points, 2));
+    TEST_ASSERT_EQUAL_UINT8(2, table.size());
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, table.apply(2000.0f));
+
+    CalibrationTable::Point bad[] = {{2000.0f, 100.0f}, {1000.0f, 200.0f}};
+    TEST_ASSERT_FALSE(table.load(bad, 2));
+    TEST_ASSERT_TRUE(table.isEmpty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_table_maps_to_zero);
+    RUN_TEST(test_single_point_is_a_line_through_tare);
+    RUN_TEST(test_interpolates_between_points_and_extrapolates_last_segment);
+    RUN_TEST(test_points_are_kept_sorted_by_weight);
+    RUN_TEST(test_point_near_same_weight_replaces_old_one);
+    RUN_TEST(test_rejects_invalid_points);
+    RUN_TEST(test_table_holds_at_most_max_points);
+    RUN_TEST(test_load_replaces_table_and_clears_on_invalid_input);
+    return UNITY_END();
+}
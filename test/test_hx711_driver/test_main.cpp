@@ -0,0 +1,257 @@
+// Hx711Driver against the simulated chip in sim/hx711_sim.h (pio test -e native).
+#include <unity.h>
+#include "hx711_driver.h"
+#include "sim/hx711_sim.h"
+
+typedef Hx711Driver<SimHx711Io> Driver;
+
+// Two chips on one clock line. A floating lane reads high whatever its chip does,
+// like a disconnected DOUT with the pull-up.
+class TwoChipIo {
+public:
+    TwoChipIo(SimHx711& first, SimHx711& second) : chips{&first, &second}, floating(0) {}
+
+    void begin() {
+        for (SimHx711* chip : chips) chip->setSck(false);
+    }
+
+    uint8_t lanes() const {
+        return 2;
+    }
+
+    uint32_t readDout() {
+        return levels();
+    }
+
+    uint32_t clockBit() {
+        for (SimHx711* chip : chips) chip->setSck(true);
+        advance(1);
+        uint32_t sampled = levels();
+        for (SimHx711* chip : chips) chip->setSck(false);
+        advance(1);
+        return sampled;
+    }
+
+    void attachReadyInterrupt(void (*)(void*), void*) {}
+    void detachReadyInterrupt() {}
+    void disableReadyInterrupt() {}
+    void enableReadyInterrupt() {}
+
+    void advance(uint64_t us) {
+        for (SimHx711* chip : chips) chip->advance(us);
+    }
+
+    void setFloating(uint32_t lanes) {
+        floating = lanes;
+    }
+
+private:
+    uint32_t levels() const {
+        uint32_t levels = floating;
+        for (uint8_t lane = 0; lane < 2; lane++) {
+            if (chips[lane]->dout()) levels |= 1u << lane;
+        }
+        return levels;
+    }
+
+    SimHx711* chips[2];
+    uint32_t floating;
+};
+
+// Runs the chip to its next conversion and reads it
+static int32_t readNext(SimHx711& chip, Driver& driver) {
+    chip.advance(chip.nextConversionAt() - chip.now());
+    TEST_ASSERT_TRUE(driver.isReady());
+    int32_t value = 0;
+    driver.readWords(&value);
+    return value;
+}
+
+static int32_t gainPulsesTimes1000(uint64_t, uint8_t gainPulses, void*) {
+    return gainPulses * 1000;
+}
+
+static void countEdge(void* arg) {
+    (*static_cast<int*>(arg))++;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_not_ready_until_conversion() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+
+    TEST_ASSERT_FALSE(driver.isReady());
+    chip.advance(SimHx711::PERIOD_80SPS_US - 1);
+    TEST_ASSERT_FALSE(driver.isReady());
+    chip.advance(1);
+    TEST_ASSERT_TRUE(driver.isReady());
+}
+
+static void test_reads_whole_word_and_releases_dout() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+    chip.setValue(0x123456);
+
+    TEST_ASSERT_EQUAL_INT32(0x123456, readNext(chip, driver));
+    TEST_ASSERT_FALSE(driver.isReady());
+    TEST_ASSERT_EQUAL_UINT32(1, chip.getStats().wordsRead);
+    TEST_ASSERT_EQUAL_UINT32(0, chip.getStats().extraPulses);
+    TEST_ASSERT_EQUAL_UINT32(0, chip.getStats().truncatedReads);
+}
+
+static void test_sign_extends_negative_words() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+
+    const int32_t values[] = {0, 1, -1, -12345, 0x7FFFFF, -0x800000, 0x800000 - 2, -0x7FFFFF};
+    for (int32_t value : values) {
+        chip.setValue(value);
+        TEST_ASSERT_EQUAL_INT32(value, readNext(chip, driver));
+    }
+}
+
+static void test_gain_pulses_select_next_input() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+    chip.setValueSource(gainPulsesTimes1000, nullptr);
+
+    // Power-on default is channel A, gain 128
+    TEST_ASSERT_EQUAL_INT32(1000, readNext(chip, driver));
+    TEST_ASSERT_EQUAL_UINT8(1, chip.getGainPulses());
+
+    driver.setGain(Driver::GAIN_B32);
+    TEST_ASSERT_EQUAL_INT32(1000, readNext(chip, driver));
+    TEST_ASSERT_EQUAL_UINT8(2, chip.getGainPulses());
+    TEST_ASSERT_EQUAL_INT32(2000, readNext(chip, driver));
+
+    driver.setGain(Driver::GAIN_A64);
+    TEST_ASSERT_EQUAL_INT32(2000, readNext(chip, driver));
+    TEST_ASSERT_EQUAL_UINT8(3, chip.getGainPulses());
+    TEST_ASSERT_EQUAL_INT32(3000, readNext(chip, driver));
+
+    TEST_ASSERT_EQUAL_UINT32(0, chip.getStats().extraPulses);
+}
+
+static void test_sck_high_stays_below_power_down() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+    chip.setValue(-4242);
+
+    for (int i = 0; i < 1000; i++) {
+        driver.setGain(i % 2 ? Driver::GAIN_B32 : Driver::GAIN_A128);
+        TEST_ASSERT_EQUAL_INT32(-4242, readNext(chip, driver));
+    }
+    const SimHx711::Stats& stats = chip.getStats();
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(SimHx711::POWER_DOWN_US, stats.maxSckHighUs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.powerDowns);
+    TEST_ASSERT_EQUAL_UINT32(1000, stats.wordsRead);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overwritten);
+}
+
+// The check above only means something if a slow clock does trip the model
+static void test_slow_clock_powers_chip_down() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip, SimHx711::POWER_DOWN_US + 1);
+    Driver driver(io);
+    driver.begin();
+
+    chip.advance(chip.nextConversionAt() - chip.now());
+    int32_t value = 0;
+    driver.readWords(&value);
+    TEST_ASSERT_GREATER_THAN(0, chip.getStats().powerDowns);
+}
+
+static void test_dead_lane_is_masked_and_recovers() {
+    SimHx711 first(SimHx711::PERIOD_80SPS_US);
+    SimHx711 second(SimHx711::PERIOD_80SPS_US);
+    first.setValue(111);
+    second.setValue(-222);
+    Hx711Driver<TwoChipIo> driver((TwoChipIo(first, second)));
+    driver.begin();
+    TwoChipIo& io = driver.pins();
+    io.setFloating(0x2);
+
+    // The second lane holds everything up until it has missed FAULT_MISSES times
+    for (uint8_t miss = 1; miss <= Hx711Driver<TwoChipIo>::FAULT_MISSES; miss++) {
+        io.advance(SimHx711::PERIOD_80SPS_US);
+        TEST_ASSERT_EQUAL_UINT32(0, driver.faultedLanes());
+        TEST_ASSERT_FALSE(driver.isReady());
+        driver.noteReadyTimeout();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0x2, driver.faultedLanes());
+    TEST_ASSERT_TRUE(driver.isReady());
+
+    int32_t words[2];
+    driver.readWords(words);
+    TEST_ASSERT_EQUAL_INT32(111, words[0]);
+
+    // Reconnected: back after RECOVER_READS readouts that found a conversion waiting
+    io.setFloating(0);
+    for (uint8_t read = 0; read < Hx711Driver<TwoChipIo>::RECOVER_READS; read++) {
+        TEST_ASSERT_EQUAL_UINT32(0x2, driver.faultedLanes());
+        io.advance(SimHx711::PERIOD_80SPS_US);
+        TEST_ASSERT_TRUE(driver.isReady());
+        driver.readWords(words);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, driver.faultedLanes());
+
+    io.advance(SimHx711::PERIOD_80SPS_US);
+    TEST_ASSERT_TRUE(driver.isReady());
+    driver.readWords(words);
+    TEST_ASSERT_EQUAL_INT32(111, words[0]);
+    TEST_ASSERT_EQUAL_INT32(-222, words[1]);
+}
+
+static void test_masked_interrupt_ignores_data_bits() {
+    SimHx711 chip(SimHx711::PERIOD_80SPS_US);
+    SimHx711Io io(chip);
+    Driver driver(io);
+    driver.begin();
+    int edges = 0;
+    driver.attachReadyInterrupt(countEdge, &edges);
+    chip.setValue(0x555555);
+
+    // Unmasked, the alternating data bits raise an edge each
+    chip.advance(chip.nextConversionAt() - chip.now());
+    TEST_ASSERT_EQUAL_INT(1, edges);
+    int32_t value = 0;
+    driver.readWords(&value);
+    TEST_ASSERT_GREATER_THAN(1, edges);
+
+    // Masked around the readout, only the conversion itself does
+    edges = 0;
+    chip.advance(chip.nextConversionAt() - chip.now());
+    driver.disableReadyInterrupt();
+    driver.readWords(&value);
+    driver.enableReadyInterrupt();
+    TEST_ASSERT_EQUAL_INT(1, edges);
+    TEST_ASSERT_EQUAL_INT32(0x555555, value);
+
+    chip.advance(chip.nextConversionAt() - chip.now());
+    TEST_ASSERT_EQUAL_INT(2, edges);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_not_ready_until_conversion);
+    RUN_TEST(test_reads_whole_word_and_releases_dout);
+    RUN_TEST(test_sign_extends_negative_words);
+    RUN_TEST(test_gain_pulses_select_next_input);
+    RUN_TEST(test_sck_high_stays_below_power_down);
+    RUN_TEST(test_slow_clock_powers_chip_down);
+    RUN_TEST(test_dead_lane_is_masked_and_recovers);
+    RUN_TEST(test_masked_interrupt_ignores_data_bits);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+// RateEstimator and secondsToEmpty (pio test -e native).
+#include <unity.h>
+#include "rate_estimator.h"
+
+typedef RateEstimator<60> Estimator;
+
+// One reading per bucket; each push completes the bucket before it
+static void feedLine(Estimator& rate, uint32_t& t, int buckets, float& grams, float gramsPerHour) {
+    for (int i = 0; i < buckets; i++) {
+        rate.push(t, grams);
+        t += Estimator::BUCKET_MS;
+        grams += gramsPerHour * Estimator::BUCKET_MS / 3600000.0f;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_reports_nothing_until_min_buckets() {
+    Estimator rate;
+    uint32_t t = 0;
+    float grams = 1000.0f;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, rate.gramsPerHour());
+
+    feedLine(rate, t, Estimator::MIN_BUCKETS, grams, -30.0f);
+    TEST_ASSERT_EQUAL_UINT16(Estimator::MIN_BUCKETS - 1, rate.count());
+    TEST_ASSERT_FALSE(rate.valid());
+
+    feedLine(rate, t, 1, grams, -30.0f);
+    TEST_ASSERT_TRUE(rate.valid());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -30.0f, rate.gramsPerHour());
+}
+
+static void test_readings_are_averaged_per_bucket() {
+    Estimator rate;
+    uint32_t t = 0;
+    // Ten readings a second; only the first reading of the next bucket completes one
+    for (int bucket = 0; bucket < 20; bucket++) {
+        for (uint32_t ms = 0; ms < Estimator::BUCKET_MS; ms += 100) {
+            bool completed = rate.push(t + ms, 500.0f - bucket * 0.5f + (ms % 200 ? 1.0f : -1.0f));
+            TEST_ASSERT_EQUAL(bucket > 0 && ms == 0, completed);
+        }
+        t += Estimator::BUCKET_MS;
+    }
+    TEST_ASSERT_EQUAL_UINT16(19, rate.count());
+    // 0.5 g per 5 s bucket
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, -360.0f, rate.gramsPerHour());
+}
+
+static void test_window_slides_and_stays_accurate() {
+    Estimator rate;
+    uint32_t t = 0;
+    float grams = 1000.0f;
+    feedLine(rate, t, 100, grams, 40.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 40.0f, rate.gramsPerHour());
+
+    // Well past RESYNC_INTERVAL additions, and the rate changed: the fit follows the last N buckets
+    feedLine(rate, t, 2000, grams, -25.0f);
+    TEST_ASSERT_EQUAL_UINT16(60, rate.count());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -25.0f, rate.gramsPerHour());
+}
+
+static void test_single_bad_bucket_is_ignored() {
+    Estimator rate;
+    uint32_t t = 0;
+    float grams = 1000.0f;
+    feedLine(rate, t, 30, grams, -30.0f);
+
+    // Someone leaned on the scale for one bucket
+    rate.push(t, grams + 300.0f);
+    uint16_t before = rate.count();
+    t += Estimator::BUCKET_MS;
+    TEST_ASSERT_TRUE(rate.push(t, grams));
+    TEST_ASSERT_EQUAL_UINT16(before, rate.count());
+
+    feedLine(rate, t, 5, grams, -30.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -30.0f, rate.gramsPerHour());
+}
+
+static void test_weight_step_restarts_the_fit() {
+    Estimator rate;
+    uint32_t t = 0;
+    float grams = 300.0f;
+    feedLine(rate, t, 30, grams, -30.0f);
+    TEST_ASSERT_TRUE(rate.valid());
+
+    // Spool swapped: the new weight is kept, so after MAX_CONSECUTIVE_REJECTS the fit starts over
+    grams += 800.0f;
+    feedLine(rate, t, Estimator::MAX_CONSECUTIVE_REJECTS + 2, grams, -30.0f);
+    TEST_ASSERT_FALSE(rate.valid());
+    TEST_ASSERT_LESS_OR_EQUAL(2, rate.count());
+
+    feedLine(rate, t, Estimator::MIN_BUCKETS, grams, -30.0f);
+    TEST_ASSERT_TRUE(rate.valid());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -30.0f, rate.gramsPerHour());
+}
+
+static void test_reset_forgets_everything() {
+    Estimator rate;
+    uint32_t t = 0;
+    float grams = 1000.0f;
+    feedLine(rate, t, 30, grams, -30.0f);
+    rate.reset();
+    TEST_ASSERT_EQUAL_UINT16(0, rate.count());
+    TEST_ASSERT_FALSE(rate.valid());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, rate.gramsPerHour());
+}
+
+static void test_seconds_to_empty() {
+    TEST_ASSERT_EQUAL_FLOAT(18000.0f, secondsToEmpty(500.0f, -100.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, secondsToEmpty(-5.0f, -100.0f));
+    // Gaining weight, drifting or unknown: no estimate
+    TEST_ASSERT_FLOAT_IS_NAN(secondsToEmpty(500.0f, 20.0f));
+    TEST_ASSERT_FLOAT_IS_NAN(secondsToEmpty(500.0f, -0.5f));
+    TEST_ASSERT_FLOAT_IS_NAN(secondsToEmpty(500.0f, NAN));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reports_nothing_until_min_buckets);
+    RUN_TEST(test_readings_are_averaged_per_bucket);
+    RUN_TEST(test_window_slides_and_stays_accurate);
+    RUN_TEST(test_single_bad_bucket_is_ignored);
+    RUN_TEST(test_weight_step_restarts_the_fit);
+    RUN_TEST(test_reset_forgets_everything);
+    RUN_TEST(test_seconds_to_empty);
+    return UNITY_END();
+}
@@ -0,0 +1,259 @@
+// VesselManager's id and name indexes, paging and deletes (pio test -e native).
+// Each test starts from an empty table in a scratch directory; Preferences has no
+// storage directory, so selections are not saved between tests.
+#include <unity.h>
+#include <FS.h>
+#include <stdlib.h>
+#include <filesystem>
+#include "vessel_manager.h"
+#include "metrics.h"
+#include "profiler.h"
+
+Metrics metrics;
+#if PROFILER_ENABLED
+Profiler profiler;
+#endif
+
+static char scratch[32];
+static FS* flash;
+static VesselManager* vessels;
+
+void setUp() {
+    snprintf(scratch, sizeof(scratch), "/tmp/vessel-test-XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(scratch));
+    flash = new FS(scratch);
+    vessels = new VesselManager(*flash);
+}
+
+void tearDown() {
+    delete vessels;
+    delete flash;
+    std::error_code error;
+    std::filesystem::remove_all(scratch, error);
+}
+
+static void test_ids_count_up_and_lookups_copy() {
+    TEST_ASSERT_EQUAL_UINT16(1, vessels->addVessel("Black PLA", 180.0f, 250.0f));
+    TEST_ASSERT_EQUAL_UINT16(2, vessels->addVessel("White PETG", 200.0f, 230.0f));
+    TEST_ASSERT_EQUAL_INT(2, vessels->getVesselCount());
+
+    VesselConfig vessel = {};
+    TEST_ASSERT_TRUE(vessels->getVessel(2, vessel));
+    TEST_ASSERT_EQUAL_STRING("White PETG", vessel.name);
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, vessel.vesselWeight);
+    TEST_ASSERT_EQUAL_FLOAT(230.0f, vessel.spoolWeight);
+
+    TEST_ASSERT_FALSE(vessels->getVessel(0, vessel));
+    TEST_ASSERT_FALSE(vessels->getVessel(3, vessel));
+    TEST_ASSERT_FALSE(vessels->hasVessel(-1));
+    TEST_ASSERT_TRUE(vessels->hasVessel(1));
+}
+
+static void test_long_names_are_truncated() {
+    char name[80];
+    memset(name, 'x', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    uint16_t id = vessels->addVessel(name, 1.0f, 1.0f);
+
+    VesselConfig vessel = {};
+    TEST_ASSERT_TRUE(vessels->getVessel(id, vessel));
+    TEST_ASSERT_EQUAL(sizeof(vessel.name) - 1, strlen(vessel.name));
+}
+
+static void test_name_order_ignores_case_and_breaks_ties_by_id() {
+    uint16_t b = vessels->addVessel("beta", 1.0f, 1.0f);
+    uint16_t a = vessels->addVessel("Alpha", 1.0f, 1.0f);
+    uint16_t c = vessels->addVessel("Charlie", 1.0f, 1.0f);
+    uint16_t a2 = vessels->addVessel("Alpha", 1.0f, 1.0f);
+
+    const uint16_t expected[] = {a, a2, b, c};
+    for (int position = 0; position < 4; position++) {
+        VesselConfig vessel = {};
+        TEST_ASSERT_TRUE(vessels->getVesselAt(position, vessel));
+        TEST_ASSERT_EQUAL_UINT16(expected[position], vessel.id);
+        TEST_ASSERT_EQUAL_INT(position, vessels->positionOf(vessel.id));
+    }
+    VesselConfig vessel = {};
+    TEST_ASSERT_FALSE(vessels->getVesselAt(4, vessel));
+    TEST_ASSERT_FALSE(vessels->getVesselAt(-1, vessel));
+    TEST_ASSERT_EQUAL_INT(-1, vessels->positionOf(99));
+}
+
+static void test_rename_moves_vessel_in_name_order() {
+    uint16_t a = vessels->addVessel("Alpha", 1.0f, 1.0f);
+    uint16_t b = vessels->addVessel("Bravo", 1.0f, 1.0f);
+    vessels->addVessel("Charlie", 1.0f, 1.0f);
+
+    TEST_ASSERT_TRUE(vessels->updateVessel(a, "Zulu", 5.0f, 6.0f));
+    TEST_ASSERT_EQUAL_INT(2, vessels->positionOf(a));
+    TEST_ASSERT_EQUAL_INT(0, vessels->positionOf(b));
+
+    VesselConfig vessel = {};
+    TEST_ASSERT_TRUE(vessels->getVessel(a, vessel));
+    TEST_ASSERT_EQUAL_STRING("Zulu", vessel.name);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, vessel.vesselWeight);
+    TEST_ASSERT_EQUAL_INT(3, vessels->getVesselCount());
+
+    TEST_ASSERT_FALSE(vessels->updateVessel(99, "Nobody", 1.0f, 1.0f));
+}
+
+static void test_pages_cover_every_vessel_once_in_order() {
+    const int total = 40;
+    for (int i = 0; i < total; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Spool %02d", (i * 7) % total);
+        vessels->addVessel(name, 1.0f, 1.0f);
+    }
+
+    VesselConfig page[VESSEL_PAGE_SIZE];
+    char cursorName[32] = "";
+    int cursorId = 0;
+    int seen = 0;
+    int pages = 0;
+    bool more = true;
+    while (more) {
+        int count = vessels->getVesselsAfter(cursorName, cursorId, page, VESSEL_PAGE_SIZE, more);
+        for (int i = 0; i < count; i++) {
+            char expected[32];
+            snprintf(expected, sizeof(expected), "Spool %02d", seen++);
+            TEST_ASSERT_EQUAL_STRING(expected, page[i].name);
+        }
+        TEST_ASSERT_TRUE(count == VESSEL_PAGE_SIZE || !more);
+        if (count == 0) break;
+        snprintf(cursorName, sizeof(cursorName), "%s", page[count - 1].name);
+        cursorId = page[count - 1].id;
+        pages++;
+    }
+    TEST_ASSERT_EQUAL_INT(total, seen);
+    TEST_ASSERT_EQUAL_INT((total + VESSEL_PAGE_SIZE - 1) / VESSEL_PAGE_SIZE, pages);
+}
+
+static void test_page_cursor_survives_deleting_its_vessel() {
+    uint16_t ids[6];
+    for (int i = 0; i < 6; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Spool %d", i);
+        ids[i] = vessels->addVessel(name, 1.0f, 1.0f);
+    }
+
+    VesselConfig page[3];
+    bool more = false;
+    TEST_ASSERT_EQUAL_INT(3, vessels->getVesselsAfter("", 0, page, 3, more));
+    TEST_ASSERT_TRUE(more);
+    TEST_ASSERT_TRUE(vessels->deleteVessel(page[2].id));
+
+    TEST_ASSERT_EQUAL_INT(3, vessels->getVesselsAfter(page[2].name, page[2].id, page, 3, more));
+    TEST_ASSERT_FALSE(more);
+    TEST_ASSERT_EQUAL_UINT16(ids[3], page[0].id);
+    TEST_ASSERT_EQUAL_UINT16(ids[5], page[2].id);
+}
+
+static void test_delete_removes_from_both_indexes() {
+    uint16_t a = vessels->addVessel("Alpha", 1.0f, 1.0f);
+    uint16_t b = vessels->addVessel("Bravo", 1.0f, 1.0f);
+    uint16_t c = vessels->addVessel("Charlie", 1.0f, 1.0f);
+
+    TEST_ASSERT_TRUE(vessels->deleteVessel(b));
+    TEST_ASSERT_FALSE(vessels->deleteVessel(b));
+    TEST_ASSERT_EQUAL_INT(2, vessels->getVesselCount());
+    TEST_ASSERT_FALSE(vessels->hasVessel(b));
+    TEST_ASSERT_EQUAL_INT(-1, vessels->positionOf(b));
+    TEST_ASSERT_EQUAL_INT(0, vessels->positionOf(a));
+    TEST_ASSERT_EQUAL_INT(1, vessels->positionOf(c));
+
+    // Ids are not handed out again
+    uint16_t d = vessels->addVessel("Bravo", 1.0f, 1.0f);
+    TEST_ASSERT_GREATER_THAN(c, d);
+    TEST_ASSERT_EQUAL_INT(1, vessels->positionOf(d));
+}
+
+static void test_deleting_selected_vessel_falls_back_to_first() {
+    TEST_ASSERT_EQUAL_INT(0, vessels->getSelectedVessel());
+    uint16_t b = vessels->addVessel("Bravo", 1.0f, 1.0f);
+    uint16_t a = vessels->addVessel("Alpha", 1.0f, 1.0f);
+
+    // The first vessel added is selected on channel 0
+    TEST_ASSERT_EQUAL_INT(b, vessels->getSelectedVessel());
+    vessels->setSelectedVessel(99);
+    TEST_ASSERT_EQUAL_INT(b, vessels->getSelectedVessel());
+
+    TEST_ASSERT_TRUE(vessels->deleteVessel(b));
+    TEST_ASSERT_EQUAL_INT(a, vessels->getSelectedVessel());
+    VesselConfig vessel = {};
+    TEST_ASSERT_TRUE(vessels->getSelectedVessel(0, vessel));
+    TEST_ASSERT_EQUAL_STRING("Alpha", vessel.name);
+
+    TEST_ASSERT_TRUE(vessels->deleteVessel(a));
+    TEST_ASSERT_EQUAL_INT(0, vessels->getSelectedVessel());
+    TEST_ASSERT_FALSE(vessels->getSelectedVessel(0, vessel));
+}
+
+static void test_every_change_is_logged() {
+    uint32_t start = vessels->getVersion();
+    uint16_t id = vessels->addVessel("Alpha", 1.0f, 1.0f);
+    vessels->updateVessel(id, "Alpha", 2.0f, 1.0f);
+    vessels->deleteVessel(id);
+
+    const VesselManager::ChangeType expected[] = {
+        VesselManager::VESSEL_ADDED, VesselManager::VESSEL_SELECTED,
+        VesselManager::VESSEL_UPDATED, VesselManager::VESSEL_DELETED, VesselManager::VESSEL_SELECTED};
+    TEST_ASSERT_EQUAL_UINT32(start + 5, vessels->getVersion());
+    for (uint32_t i = 0; i < 5; i++) {
+        VesselManager::Change change;
+        TEST_ASSERT_TRUE(vessels->getChange(start + 1 + i, change));
+        TEST_ASSERT_EQUAL_INT(expected[i], change.type);
+    }
+
+    // Older changes drop out of the log
+    for (int i = 0; i < VesselManager::CHANGE_LOG_SIZE; i++) {
+        vessels->addVessel("Filler", 1.0f, 1.0f);
+    }
+    VesselManager::Change change;
+    TEST_ASSERT_FALSE(vessels->getChange(start + 1, change));
+}
+
+// Destroying the manager writes what the background writer hadn't yet
+static void test_vessels_survive_a_restart() {
+    uint16_t a = vessels->addVessel("Alpha", 180.0f, 250.0f);
+    uint16_t b = vessels->addVessel("Bravo", 200.0f, 230.0f);
+    vessels->addVessel("Charlie", 1.0f, 1.0f);
+    vessels->updateVessel(b, "Bravo 2", 210.0f, 230.0f);
+    vessels->deleteVessel(a);
+
+    delete vessels;
+    vessels = new VesselManager(*flash);
+    TEST_ASSERT_EQUAL_INT(2, vessels->getVesselCount());
+    TEST_ASSERT_FALSE(vessels->hasVessel(a));
+    VesselConfig vessel = {};
+    TEST_ASSERT_TRUE(vessels->getVesselAt(0, vessel));
+    TEST_ASSERT_EQUAL_UINT16(b, vessel.id);
+    TEST_ASSERT_EQUAL_STRING("Bravo 2", vessel.name);
+    TEST_ASSERT_EQUAL_FLOAT(210.0f, vessel.vesselWeight);
+
+    // New ids continue after the ones on flash
+    TEST_ASSERT_GREATER_THAN(b + 1, vessels->addVessel("Delta", 1.0f, 1.0f));
+}
+
+static void test_table_is_capped_at_max_vessels() {
+    for (int i = 0; i < MAX_VESSELS; i++) {
+        TEST_ASSERT_NOT_EQUAL(0, vessels->addVessel("Spool", 1.0f, 1.0f));
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, vessels->addVessel("One too many", 1.0f, 1.0f));
+    TEST_ASSERT_EQUAL_INT(MAX_VESSELS, vessels->getVesselCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ids_count_up_and_lookups_copy);
+    RUN_TEST(test_long_names_are_truncated);
+    RUN_TEST(test_name_order_ignores_case_and_breaks_ties_by_id);
+    RUN_TEST(test_rename_moves_vessel_in_name_order);
+    RUN_TEST(test_pages_cover_every_vessel_once_in_order);
+    RUN_TEST(test_page_cursor_survives_deleting_its_vessel);
+    RUN_TEST(test_delete_removes_from_both_indexes);
+    RUN_TEST(test_deleting_selected_vessel_falls_back_to_first);
+    RUN_TEST(test_every_change_is_logged);
+    RUN_TEST(test_vessels_survive_a_restart);
+    RUN_TEST(test_table_is_capped_at_max_vessels);
+    return UNITY_END();
+}
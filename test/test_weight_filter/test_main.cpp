@@ -0,0 +1,162 @@
+// FilterChain and its stages (pio test -e native).
+#include <unity.h>
+#include "weight_filter.h"
+
+static FilterConfig onlyMedian(uint8_t window) {
+    FilterConfig config = defaultFilterConfig();
+    config.medianEnabled = true;
+    config.medianWindow = window;
+    return config;
+}
+
+static FilterConfig onlyEma(float alpha) {
+    FilterConfig config = defaultFilterConfig();
+    config.emaEnabled = true;
+    config.emaAlpha = alpha;
+    return config;
+}
+
+static FilterConfig onlyOutlier(float sigma) {
+    FilterConfig config = defaultFilterConfig();
+    config.outlierEnabled = true;
+    config.outlierSigma = sigma;
+    return config;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_default_chain_passes_readings_through() {
+    FilterChain chain;
+    const float readings[] = {0.0f, 12.5f, -3.0f, 100000.0f, 7.0f};
+    for (float x : readings) {
+        TEST_ASSERT_EQUAL_FLOAT(x, chain.process(x));
+    }
+}
+
+static void test_median_averages_middle_pair_while_filling() {
+    FilterChain chain;
+    chain.configure(onlyMedian(5));
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, chain.process(3.0f));
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, chain.process(1.0f));
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, chain.process(8.0f));
+    TEST_ASSERT_EQUAL_FLOAT(5.5f, chain.process(9.0f));
+}
+
+static void test_median_removes_single_spike() {
+    FilterChain chain;
+    chain.configure(onlyMedian(5));
+    for (int i = 0; i < 10; i++) chain.process(10.0f);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, chain.process(1000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, chain.process(-1000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, chain.process(10.0f));
+}
+
+static void test_median_follows_step_after_half_window() {
+    FilterChain chain;
+    chain.configure(onlyMedian(5));
+    for (int i = 0; i < 10; i++) chain.process(0.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, chain.process(50.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, chain.process(50.0f));
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, chain.process(50.0f));
+}
+
+// Checks the incremental sorted window against a brute-force median
+static void test_median_matches_sorted_window() {
+    FilterChain chain;
+    chain.configure(onlyMedian(7));
+    float window[7];
+    uint32_t seed = 12345;
+    for (int i = 0; i < 500; i++) {
+        seed = seed * 1103515245u + 12345u;
+        float x = (float)((seed >> 16) % 100);
+        window[i % 7] = x;
+
+        int n = i < 7 ? i + 1 : 7;
+        float sorted[7];
+        for (int j = 0; j < n; j++) sorted[j] = window[j];
+        for (int j = 1; j < n; j++) {
+            for (int k = j; k > 0 && sorted[k - 1] > sorted[k]; k--) {
+                float t = sorted[k];
+                sorted[k] = sorted[k - 1];
+                sorted[k - 1] = t;
+            }
+        }
+        float expected = n & 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) * 0.5f;
+        TEST_ASSERT_EQUAL_FLOAT(expected, chain.process(x));
+    }
+}
+
+static void test_ema_primes_with_first_reading() {
+    FilterChain chain;
+    chain.configure(onlyEma(0.5f));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, chain.process(100.0f));
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, chain.process(0.0f));
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, chain.process(0.0f));
+
+    chain.reset();
+    TEST_ASSERT_EQUAL_FLOAT(-8.0f, chain.process(-8.0f));
+}
+
+static void test_ema_out_of_range_alpha_passes_through() {
+    FilterChain chain;
+    chain.configure(onlyEma(0.0f));
+    chain.process(100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, chain.process(3.0f));
+}
+
+static void test_outlier_rejects_spike_and_lets_step_through() {
+    FilterChain chain;
+    chain.configure(onlyOutlier(3.0f));
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(100.0f + (i & 1), chain.process(100.0f + (i & 1)));
+    }
+
+    // A lone spike is replaced by the last accepted reading
+    TEST_ASSERT_EQUAL_FLOAT(101.0f, chain.process(200.0f));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, chain.process(100.0f));
+
+    // A real load change gets through after at most MAX_CONSECUTIVE_REJECTS readings
+    float out = 0.0f;
+    for (uint8_t i = 0; i <= OutlierFilter::MAX_CONSECUTIVE_REJECTS; i++) {
+        out = chain.process(500.0f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(500.0f, out);
+}
+
+static void test_outlier_accepts_everything_until_primed() {
+    FilterChain chain;
+    chain.configure(onlyOutlier(3.0f));
+    for (uint8_t i = 0; i < OutlierFilter::MIN_SAMPLES; i++) {
+        float x = i == OutlierFilter::MIN_SAMPLES - 1 ? 5000.0f : 100.0f;
+        TEST_ASSERT_EQUAL_FLOAT(x, chain.process(x));
+    }
+}
+
+static void test_chain_rejects_outliers_before_smoothing() {
+    FilterConfig config = onlyOutlier(3.0f);
+    config.emaEnabled = true;
+    config.emaAlpha = 0.5f;
+    FilterChain chain;
+    chain.configure(config);
+    for (int i = 0; i < 16; i++) chain.process(100.0f + (i & 1));
+
+    // The spike never reaches the EMA, so the output stays between the two levels
+    float out = chain.process(10000.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 100.5f, out);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_default_chain_passes_readings_through);
+    RUN_TEST(test_median_averages_middle_pair_while_filling);
+    RUN_TEST(test_median_removes_single_spike);
+    RUN_TEST(test_median_follows_step_after_half_window);
+    RUN_TEST(test_median_matches_sorted_window);
+    RUN_TEST(test_ema_primes_with_first_reading);
+    RUN_TEST(test_ema_out_of_range_alpha_passes_through);
+    RUN_TEST(test_outlier_rejects_spike_and_lets_step_through);
+    RUN_TEST(test_outlier_accepts_everything_until_primed);
+    RUN_TEST(test_chain_rejects_outliers_before_smoothing);
+    return UNITY_END();
+}
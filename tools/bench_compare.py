@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Compares two result files of the host benchmarks (pio run -e bench, see
+# src/bench/main.cpp), e.g. from the previous commit and this one.
+#
+#   tools/bench_compare.py base.json new.json [--threshold 10]
+#
+# A benchmark regressed when its time per operation grew by more than the
+# threshold (percent) or it allocates more per operation than before. The
+# exit status is 1 if any did, so CI can fail the build on it.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two host benchmark result files")
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = 0
+
+    print(f"{'benchmark':24} {'base ns':>10} {'new ns':>10} {'change':>8} {'allocs':>13}")
+    for name, result in new.items():
+        old = base.get(name)
+        if old is None:
+            print(f"{name:24} {'':>10} {result['ns_per_op']:10.1f} {'new':>8}")
+            continue
+
+        change = (result["ns_per_op"] / old["ns_per_op"] - 1.0) * 100.0 if old["ns_per_op"] else 0.0
+        allocs = f"{old['allocs_per_op']:.2f}->{result['allocs_per_op']:.2f}"
+        slower = change > args.threshold
+        allocating = result["allocs_per_op"] > old["allocs_per_op"] + 1e-3
+        flag = "  REGRESSION" if slower or allocating else ""
+        regressions += bool(flag)
+        print(f"{name:24} {old['ns_per_op']:10.1f} {result['ns_per_op']:10.1f} {change:+7.1f}% {allocs:>13}{flag}")
+
+    for name in base.keys() - new.keys():
+        print(f"{name:24} {base[name]['ns_per_op']:10.1f} {'':>10} {'removed':>8}")
+
+    if regressions:
+        print(f"\n{regressions} benchmark(s) regressed")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+# PlatformIO pre-build script: turns the web UI in data/ into the filesystem
+# image served by the firmware (see src/web_assets.h).
+#
+# Every asset is gzipped. Assets referenced from HTML pages are renamed to
+# include a hash of their content (script.js -> script.1a2b3c4d.js) so the
+# browser may cache them for good; the pages themselves keep their names and
+# are revalidated by ETag. The manifest lists each URL with its ETag and
+# whether it may be cached indefinitely.
+#
+# With `custom_web_assets = flash` in platformio.ini the same files are also
+# compiled into the firmware as constant arrays (web_assets_data.h, in the
+# build directory) and served from flash without the filesystem.
+
+import gzip
+import hashlib
+import os
+import re
+
+Import("env")
+
+SOURCE_DIR = os.path.join(env.subst("$PROJECT_DIR"), "data")
+OUTPUT_DIR = env.subst("$PROJECT_DATA_DIR")
+GENERATED_DIR = os.path.join(env.subst("$BUILD_DIR"), "web")
+GENERATED_HEADER = "web_assets_data.h"
+MANIFEST = "assets.txt"
+HASH_LENGTH = 8
+
+# Requested by browsers under their plain names, so never renamed
+FIXED_NAMES = {"favicon.ico"}
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+    ".svg": "image/svg+xml",
+}
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:HASH_LENGTH]
+
+
+def hashed_name(name, digest):
+    stem, ext = os.path.splitext(name)
+    return "%s.%s%s" % (stem, digest, ext)
+
+
+def rewrite_references(html, renamed):
+    # href="style.css", src="/script.js" -> "/style.1a2b3c4d.css"
+    def replace(match):
+        target = renamed.get(match.group(2).lstrip("/"))
+        if target is None:
+            return match.group(0)
+        return '%s="/%s"' % (match.group(1), target)
+    return re.sub(r'(href|src)="([^"?#:]+)"', replace, html)
+
+
+def compress(data):
+    # mtime=0 keeps the output identical for identical input
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def write_if_changed(path, data):
+    # An unchanged header must not trigger a firmware rebuild
+    if os.path.exists(path):
+        with open(path, "rb") as f:
+            if f.read() == data:
+                return
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def write_header(entries):
+    lines = [
+        "// Generated by tools/build_web.py from data/, do not edit",
+        "#pragma once",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "struct EmbeddedAsset {",
+        "    const char* path;",
+        "    const char* etag;",
+        "    const char* contentType;",
+        "    bool immutable;",
+        "    const uint8_t* data;    // Gzipped",
+        "    size_t length;",
+        "};",
+        "",
+    ]
+    for i, (served, digest, immutable, data) in enumerate(entries):
+        lines.append("static const uint8_t EMBEDDED_ASSET_%d[] = {" % i)
+        for offset in range(0, len(data), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in data[offset:offset + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("static const EmbeddedAsset EMBEDDED_ASSETS[] = {")
+    for i, (served, digest, immutable, data) in enumerate(entries):
+        content_type = CONTENT_TYPES.get(os.path.splitext(served)[1], "application/octet-stream")
+        lines.append('    {"/%s", "%s", "%s", %s, EMBEDDED_ASSET_%d, sizeof(EMBEDDED_ASSET_%d)},' % (
+            served, digest, content_type, "true" if immutable else "false", i, i))
+    lines.append("};")
+    lines.append("static const size_t EMBEDDED_ASSET_COUNT = sizeof(EMBEDDED_ASSETS) / sizeof(EMBEDDED_ASSETS[0]);")
+    lines.append("")
+
+    os.makedirs(GENERATED_DIR, exist_ok=True)
+    write_if_changed(os.path.join(GENERATED_DIR, GENERATED_HEADER), "\n".join(lines).encode("utf-8"))
+
+
+def build_assets():
+    os.makedirs(OUTPUT_DIR, exist_ok=True)
+    for name in os.listdir(OUTPUT_DIR):
+        os.remove(os.path.join(OUTPUT_DIR, name))
+
+    sources = {}
+    for name in sorted(os.listdir(SOURCE_DIR)):
+        path = os.path.join(SOURCE_DIR, name)
+        if os.path.isfile(path):
+            with open(path, "rb") as f:
+                sources[name] = f.read()
+
+    pages = [name for name in sources if name.endswith(".html")]
+    renamed = {}
+    for name, data in sources.items():
+        if name not in pages and name not in FIXED_NAMES:
+            renamed[name] = hashed_name(name, content_hash(data))
+
+    entries = []
+    for name, data in sources.items():
+        if name in pages:
+            data = rewrite_references(data.decode("utf-8"), renamed).encode("utf-8")
+        served = renamed.get(name, name)
+        compressed = compress(data)
+        with open(os.path.join(OUTPUT_DIR, served + ".gz"), "wb") as f:
+            f.write(compressed)
+        entries.append((served, content_hash(data), name in renamed, compressed))
+
+    with open(os.path.join(OUTPUT_DIR, MANIFEST), "w") as manifest:
+        for served, digest, immutable, _ in entries:
+            manifest.write("/%s %s %d\n" % (served, digest, 1 if immutable else 0))
+
+    print("Web assets: %d files in %s" % (len(entries), OUTPUT_DIR))
+    return entries
+
+
+entries = build_assets()
+if env.GetProjectOption("custom_web_assets", "filesystem") == "flash":
+    write_header(entries)
+    env.Append(CPPPATH=[GENERATED_DIR], CPPDEFINES=["WEB_ASSETS_IN_FLASH"])
+    print("Web assets: compiled into the firmware")